@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+/* each timed run aims for about this long */
+#define TARGET_SECONDS 0.1
+#define RUNS 5
+#define MAX_RESULTS 128
+
+typedef struct
+{
+   const char *name;
+   unsigned long long ops;
+   double seconds;
+} benchResult_t;
+
+static benchResult_t results[MAX_RESULTS];
+static unsigned int resultCount;
+
+volatile float benchSink;
+
+double benchNow(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + (t.tv_nsec * 1e-9);
+}
+
+void benchRecord(const char *name, unsigned long long ops, double seconds)
+{
+   if ((resultCount < MAX_RESULTS) && (ops > 0))
+   {
+      results[resultCount].name = name;
+      results[resultCount].ops = ops;
+      results[resultCount].seconds = seconds;
+      resultCount++;
+   }
+   fprintf(stderr, "%-36s %12.2f ns/op\n", name, (seconds * 1e9) / (ops ? ops : 1));
+}
+
+void benchRun(const char *name, benchFunc func)
+{
+   unsigned long long iterations = 1, ops = 0;
+   double elapsed = 0.0, best = 0.0;
+   unsigned long long bestOps = 0;
+   int run;
+
+   /* grow the iteration count until a run takes long enough to time */
+   for (;;)
+   {
+      double start = benchNow();
+      ops = func(iterations);
+      elapsed = benchNow() - start;
+      if ((elapsed >= TARGET_SECONDS / 10) || (iterations >= (1ULL << 40)))
+         break;
+      iterations *= 2;
+   }
+   if (elapsed > 0.0)
+      iterations = (unsigned long long)(iterations * (TARGET_SECONDS / elapsed)) + 1;
+
+   /* the quickest run is the one with the least interference */
+   for (run = 0; run < RUNS; run++)
+   {
+      double start = benchNow();
+      ops = func(iterations);
+      elapsed = benchNow() - start;
+      if ((run == 0) || (elapsed / ops < best / bestOps))
+      {
+         best = elapsed;
+         bestOps = ops;
+      }
+   }
+
+   benchRecord(name, bestOps, best);
+}
+
+static void printJson(FILE *f)
+{
+   unsigned int i;
+
+   fprintf(f, "{\n  \"benchmarks\": [\n");
+   for (i = 0; i < resultCount; i++)
+   {
+      benchResult_t *r = &results[i];
+      fprintf(f, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f, \"ops\": %llu}%s\n",
+              r->name,
+              (r->seconds * 1e9) / r->ops,
+              r->ops / r->seconds,
+              r->ops,
+              (i + 1 < resultCount) ? "," : "");
+   }
+   fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+   const char *filter = (argc > 1) ? argv[1] : NULL;
+
+   /* human readable progress goes to stderr, the JSON to stdout */
+   if (!filter || (strcmp(filter, "esutil") == 0))
+   {
+      esutilBenchmarks();
+      esutilHppBenchmarks();
+   }
+   if (!filter || (strcmp(filter, "escull") == 0))
+      escullBenchmarks();
+   if (!filter || (strcmp(filter, "piglut") == 0))
+      piglutBenchmarks();
+
+   printJson(stdout);
+   return 0;
+}
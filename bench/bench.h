@@ -0,0 +1,36 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* a block of work timed by the harness, returns the number of operations
+   it performed so the cost can be reported per op */
+typedef unsigned long long (*benchFunc)(unsigned long long iterations);
+
+/* monotonic time in seconds */
+double benchNow(void);
+
+/* calibrates the iteration count, takes the best of several runs and
+   records the result under name */
+void benchRun(const char *name, benchFunc func);
+
+/* records a result measured by the caller */
+void benchRecord(const char *name, unsigned long long ops, double seconds);
+
+/* stops the compiler throwing away results */
+extern volatile float benchSink;
+
+void esutilBenchmarks(void);
+void esutilHppBenchmarks(void);
+void escullBenchmarks(void);
+void piglutBenchmarks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BENCH_H_ */
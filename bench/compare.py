@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""Compares two piglut benchmark runs and flags regressions.
+
+usage: compare.py baseline.json current.json [threshold_percent]
+
+Exits non-zero if any benchmark's ns/op grew by more than the threshold
+(default 5%).
+"""
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b for b in json.load(f)["benchmarks"]}
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write(__doc__)
+        return 2
+
+    baseline = load(argv[1])
+    current = load(argv[2])
+    threshold = float(argv[3]) if len(argv) > 3 else 5.0
+    regressions = 0
+
+    print("%-36s %12s %12s %9s" % ("benchmark", "base ns/op", "ns/op", "change"))
+    for name in sorted(set(baseline) | set(current)):
+        if name not in baseline or name not in current:
+            where = "baseline" if name not in baseline else "current"
+            print("%-36s %s" % (name, "missing from " + where))
+            continue
+
+        base = baseline[name]["ns_per_op"]
+        now = current[name]["ns_per_op"]
+        change = ((now - base) / base) * 100.0 if base else 0.0
+        flag = ""
+        if change > threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif change < -threshold:
+            flag = "  improved"
+        print("%-36s %12.2f %12.2f %+8.1f%%%s" % (name, base, now, change, flag))
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
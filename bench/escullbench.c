@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "escull.h"
+
+#define MAX_OBJECTS 1000000
+
+static float *data[7];
+static unsigned int *visible;
+static unsigned int objectCount;
+static ESFrustumPlanes frustum;
+static ESBvh *bvh;
+
+static ESBoxArray boxes(void)
+{
+   ESBoxArray b = { data[0], data[1], data[2], data[3], data[4], data[5], objectCount };
+   return b;
+}
+
+/* objects scattered through a cube around a camera looking down -z, so
+   roughly a tenth end up visible */
+static int setup(void)
+{
+   ESMatrix projection, view;
+   unsigned int i;
+   int k;
+
+   for (k = 0; k < 7; k++)
+   {
+      data[k] = (float *)malloc(MAX_OBJECTS * sizeof(float));
+      if (!data[k])
+         return 0;
+   }
+   visible = (unsigned int *)malloc(MAX_OBJECTS * sizeof(unsigned int));
+   if (!visible)
+      return 0;
+
+   srand(1);
+   for (i = 0; i < MAX_OBJECTS; i++)
+   {
+      data[0][i] = (rand() % 2000) / 10.0f - 100.0f;
+      data[1][i] = (rand() % 2000) / 10.0f - 100.0f;
+      data[2][i] = (rand() % 2000) / 10.0f - 100.0f;
+      data[3][i] = data[4][i] = data[5][i] = data[6][i] = (rand() % 20) / 10.0f;
+   }
+
+   esMatrixLoadIdentity(&projection);
+   esPerspective(&projection, 60.0f, 1.5f, 1.0f, 100.0f);
+   esMatrixLoadIdentity(&view);
+   esLookAt(&view, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f);
+   esMatrixMultiply(&view, &view, &projection);
+   esFrustumPlanesFromMatrix(&frustum, &view);
+   return 1;
+}
+
+static unsigned long long cullBoxes(unsigned long long n)
+{
+   ESBoxArray b = boxes();
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      benchSink = (float)esCullBoxes(&frustum, &b, visible);
+   return n * objectCount;
+}
+
+static unsigned long long cullSpheres(unsigned long long n)
+{
+   ESSphereArray s = { data[0], data[1], data[2], data[6], objectCount };
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      benchSink = (float)esCullSpheres(&frustum, &s, visible);
+   return n * objectCount;
+}
+
+static unsigned long long cullBvh(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      benchSink = (float)esBvhCull(bvh, &frustum, visible);
+   return n * objectCount;
+}
+
+void escullBenchmarks(void)
+{
+   static const unsigned int counts[] = { 10000, 100000, MAX_OBJECTS };
+   static const char *boxNames[] = { "escull/boxes_10k", "escull/boxes_100k", "escull/boxes_1m" };
+   static const char *sphereNames[] = { "escull/spheres_10k", "escull/spheres_100k", "escull/spheres_1m" };
+   static const char *bvhNames[] = { "escull/bvh_10k", "escull/bvh_100k", "escull/bvh_1m" };
+   unsigned int i;
+
+   if (!setup())
+   {
+      fprintf(stderr, "escull: out of memory, skipping\n");
+      return;
+   }
+
+   /* ns/op here is per object tested */
+   for (i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+   {
+      ESBoxArray b;
+
+      objectCount = counts[i];
+      b = boxes();
+      benchRun(boxNames[i], cullBoxes);
+      benchRun(sphereNames[i], cullSpheres);
+
+      bvh = esBvhCreate(&b);
+      if (bvh)
+      {
+         benchRun(bvhNames[i], cullBvh);
+         esBvhDestroy(bvh);
+      }
+   }
+}
@@ -0,0 +1,150 @@
+#include "bench.h"
+#include "esutil.h"
+
+/* a typical skeleton fits in one uniform palette */
+#define JOINTS 64
+
+static ESMatrix a, b, c;
+static ESQuaternion qa, qb, qc;
+static ESDualQuaternion da, db, dc;
+static ESDualQuaternion joints[JOINTS];
+static ESMatrix palette[JOINTS];
+
+static void setup(void)
+{
+   int i;
+
+   esMatrixLoadIdentity(&a);
+   esRotate(&a, 30.0f, 0.0f, 1.0f, 0.0f);
+   esTranslate(&a, 1.0f, 2.0f, 3.0f);
+   esMatrixLoadIdentity(&b);
+   esPerspective(&b, 60.0f, 1.5f, 1.0f, 100.0f);
+
+   esQuaternionFromAxisAngle(&qa, 30.0f, 0.0f, 1.0f, 0.0f);
+   esQuaternionFromAxisAngle(&qb, -70.0f, 1.0f, 1.0f, 0.0f);
+   esDualQuaternionFromRotationTranslation(&da, &qa, 1.0f, 2.0f, 3.0f);
+   esDualQuaternionFromRotationTranslation(&db, &qb, -4.0f, 0.5f, 2.0f);
+
+   /* a simple chain, each joint relative to the previous one */
+   esDualQuaternionLoadIdentity(&joints[0]);
+   for (i = 1; i < JOINTS; i++)
+      esDualQuaternionMultiply(&joints[i], &joints[i - 1], (i & 1) ? &da : &db);
+}
+
+static unsigned long long multiply(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      esMatrixMultiply(&c, &a, &b);
+   benchSink = c.m[0][0];
+   return n;
+}
+
+static unsigned long long rotate(unsigned long long n)
+{
+   unsigned long long i;
+   esMatrixLoadIdentity(&c);
+   for (i = 0; i < n; i++)
+      esRotate(&c, 1.0f, 0.3f, 0.5f, 0.8f);
+   benchSink = c.m[0][0];
+   return n;
+}
+
+static unsigned long long lookAt(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+   {
+      esMatrixLoadIdentity(&c);
+      esLookAt(&c, 0.0f, 2.0f, 5.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+   }
+   benchSink = c.m[0][0];
+   return n;
+}
+
+static unsigned long long inverse(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      esInverse(&a, &c);
+   benchSink = c.m[0][0];
+   return n;
+}
+
+static unsigned long long perspective(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+   {
+      esMatrixLoadIdentity(&c);
+      esPerspective(&c, 60.0f, 1.5f, 1.0f, 100.0f);
+   }
+   benchSink = c.m[0][0];
+   return n;
+}
+
+static unsigned long long rotateQuaternion(unsigned long long n)
+{
+   unsigned long long i;
+   ESQuaternion q;
+   esQuaternionFromAxisAngle(&q, 1.0f, 0.3f, 0.5f, 0.8f);
+   esMatrixLoadIdentity(&c);
+   for (i = 0; i < n; i++)
+      esRotateQuaternion(&c, &q);
+   benchSink = c.m[0][0];
+   return n;
+}
+
+static unsigned long long slerp(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      esQuaternionSlerp(&qc, &qa, &qb, (float)(i & 63) * (1.0f / 64.0f));
+   benchSink = qc.w;
+   return n;
+}
+
+static unsigned long long dualQuaternionMultiply(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      esDualQuaternionMultiply(&dc, &da, &db);
+   benchSink = dc.dual.x;
+   return n;
+}
+
+/* per joint, against converting one at a time */
+static unsigned long long paletteScalar(unsigned long long n)
+{
+   unsigned long long i;
+   int j;
+   for (i = 0; i < n; i++)
+      for (j = 0; j < JOINTS; j++)
+         esDualQuaternionToMatrix(&palette[j], &joints[j]);
+   benchSink = palette[JOINTS - 1].m[3][0];
+   return n * JOINTS;
+}
+
+static unsigned long long paletteBatched(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+      esBuildSkinningPalette(palette, joints, JOINTS);
+   benchSink = palette[JOINTS - 1].m[3][0];
+   return n * JOINTS;
+}
+
+void esutilBenchmarks(void)
+{
+   setup();
+   benchRun("esutil/multiply", multiply);
+   benchRun("esutil/rotate", rotate);
+   benchRun("esutil/lookAt", lookAt);
+   benchRun("esutil/inverse", inverse);
+   benchRun("esutil/perspective", perspective);
+   benchRun("esutil/rotate_quaternion", rotateQuaternion);
+   benchRun("esutil/quaternion_slerp", slerp);
+   benchRun("esutil/dual_quaternion_multiply", dualQuaternionMultiply);
+   benchRun("esutil/palette_scalar", paletteScalar);
+   benchRun("esutil/palette_batched", paletteBatched);
+}
@@ -0,0 +1,120 @@
+#include "bench.h"
+#include "esutil.hpp"
+
+/* the same transforms built through the C functions and through esutil.hpp,
+   inputs vary with the loop so nothing folds beyond what the types allow */
+
+static ESMatrix c;
+
+/* the inline versions would otherwise be hoisted out of the loop */
+static inline void escape(const void *p)
+{
+   __asm__ __volatile__("" : : "g"(p) : "memory");
+}
+
+static unsigned long long mvpC(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+   {
+      float t = (float)(i & 255);
+      esMatrixLoadIdentity(&c);
+      esPerspective(&c, 60.0f, 1.5f, 1.0f, 100.0f);
+      esTranslate(&c, 0.0f, 0.0f, -t);
+      esRotate(&c, t, 0.0f, 1.0f, 0.0f);
+      esScale(&c, 2.0f, 2.0f, 2.0f);
+   }
+   benchSink = c.m[0][0];
+   return n;
+}
+
+static unsigned long long mvpCpp(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+   {
+      float t = (float)(i & 255);
+      c = (es::perspective(60.0f, 1.5f, 1.0f, 100.0f) *
+           es::translation(0.0f, 0.0f, -t) *
+           es::rotation(t, 0.0f, 1.0f, 0.0f) *
+           es::scale(2.0f, 2.0f, 2.0f)).matrix;
+      escape(&c);
+   }
+   benchSink = c.m[0][0];
+   return n;
+}
+
+/* 2d sprite placement, where the projection is a screen sized ortho */
+static unsigned long long spriteC(unsigned long long n)
+{
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+   {
+      float x = (float)(i & 511);
+      esMatrixLoadIdentity(&c);
+      esOrtho(&c, 0.0f, 1920.0f, 0.0f, 1080.0f, -1.0f, 1.0f);
+      esTranslate(&c, x, 100.0f, 0.0f);
+      esScale(&c, 64.0f, 64.0f, 1.0f);
+   }
+   benchSink = c.m[3][0];
+   return n;
+}
+
+static unsigned long long spriteCpp(unsigned long long n)
+{
+   static constexpr es::Affine screen = es::ortho(0.0f, 1920.0f, 0.0f, 1080.0f, -1.0f, 1.0f);
+   unsigned long long i;
+   for (i = 0; i < n; i++)
+   {
+      float x = (float)(i & 511);
+      c = es::toProjective(screen * es::translation(x, 100.0f, 0.0f) * es::scale(64.0f, 64.0f, 1.0f)).matrix;
+      escape(&c);
+   }
+   benchSink = c.m[3][0];
+   return n;
+}
+
+static unsigned long long composeAffineC(unsigned long long n)
+{
+   ESMatrix a, b;
+   unsigned long long i;
+
+   esMatrixLoadIdentity(&a);
+   esRotate(&a, 30.0f, 0.0f, 1.0f, 0.0f);
+   esTranslate(&a, 1.0f, 2.0f, 3.0f);
+   b = a;
+   for (i = 0; i < n; i++)
+   {
+      b.m[3][0] = (float)(i & 255);
+      esMatrixMultiply(&c, &a, &b);
+   }
+   benchSink = c.m[3][0];
+   return n;
+}
+
+static unsigned long long composeAffineCpp(unsigned long long n)
+{
+   es::Affine a = es::rotation(30.0f, 0.0f, 1.0f, 0.0f) * es::translation(1.0f, 2.0f, 3.0f);
+   es::Affine b = a;
+   es::Affine r = a;
+   unsigned long long i;
+
+   for (i = 0; i < n; i++)
+   {
+      b.m[3][0] = (float)(i & 255);
+      r = b * a;
+      escape(&r);
+   }
+   benchSink = r.m[3][0];
+   return n;
+}
+
+extern "C" void esutilHppBenchmarks(void)
+{
+   benchRun("esutil/mvp_c", mvpC);
+   benchRun("esutil/mvp_cpp", mvpCpp);
+   benchRun("esutil/sprite_c", spriteC);
+   benchRun("esutil/sprite_cpp", spriteCpp);
+   benchRun("esutil/compose_affine_c", composeAffineC);
+   benchRun("esutil/compose_affine_cpp", composeAffineCpp);
+}
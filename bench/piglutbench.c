@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+#include "bench.h"
+#include "piglut_internal.h"
+#include "piglutgl.h"
+#include "piglutcmd.h"
+#include "piglutres.h"
+
+#define FRAMES 20000
+#define KEYS 20000
+#define CONFIG_SELECTIONS 200
+#define STATE_DRAWS 20000
+#define PACKETS 5000
+#define TEXTURES 8
+#define RESOURCES 64
+#define RESOURCE_USES 200000
+#define RESOURCE_FRAMES 2000
+/* per frame, cycling through all of them with room for half */
+#define RESOURCES_PER_FRAME 8
+#define EXPORT_FRAMES 5000
+#define EXPORT_BUFFERS 3
+
+static unsigned long long counter;
+static unsigned long long target;
+static double startTime;
+static double endTime;
+
+static void emptyDisplay(void *pg)
+{
+   if (++counter == target)
+   {
+      endTime = benchNow();
+      piglutLeaveMainLoop(pg);
+   }
+}
+
+/* every frame asks for the next one, so each goes through the wakeup */
+static void redisplayDisplay(void *pg)
+{
+   piglutPostRedisplay(pg);
+   emptyDisplay(pg);
+}
+
+static bool countKey(void *pg, char key)
+{
+   if (++counter == target)
+   {
+      endTime = benchNow();
+      return true;
+   }
+   return false;
+}
+
+/* piglut's own selection, as made when each output is opened */
+static void selectConfigs(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+   EGLConfig config;
+   double start = benchNow();
+   int i;
+
+   for (i = 0; i < CONFIG_SELECTIONS; i++)
+      piglutChooseConfig(p, p->outputs[0].bpp, &config);
+
+   benchRecord("piglut/config_select", CONFIG_SELECTIONS, benchNow() - start);
+   piglutLeaveMainLoop(pg);
+}
+
+static GLuint createProgram(void)
+{
+   static const char *vertexSource =
+      "attribute vec4 position;\n"
+      "void main() { gl_Position = position; }\n";
+   static const char *fragmentSource =
+      "precision mediump float;\n"
+      "uniform vec4 color;\n"
+      "uniform sampler2D texture;\n"
+      "void main() { gl_FragColor = color * texture2D(texture, vec2(0.5)); }\n";
+   GLuint program = glCreateProgram();
+   GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+   GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+
+   glShaderSource(vertex, 1, &vertexSource, NULL);
+   glCompileShader(vertex);
+   glShaderSource(fragment, 1, &fragmentSource, NULL);
+   glCompileShader(fragment);
+   glAttachShader(program, vertex);
+   glAttachShader(program, fragment);
+   glLinkProgram(program);
+   glDeleteShader(vertex);
+   glDeleteShader(fragment);
+   return program;
+}
+
+/* the per draw state a typical scene sets, all of it redundant after the
+   first draw.  No draws are issued, so this is purely the call overhead */
+static void glStateCalls(void *pg)
+{
+   GLuint program = createProgram();
+   GLint color = glGetUniformLocation(program, "color");
+   GLuint texture;
+   double start;
+   int i;
+
+   glGenTextures(1, &texture);
+   glBindTexture(GL_TEXTURE_2D, texture);
+
+   start = benchNow();
+   for (i = 0; i < STATE_DRAWS; i++)
+   {
+      glUseProgram(program);
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glUniform4f(color, 1.0f, 0.5f, 0.25f, 1.0f);
+   }
+   glFinish();
+   benchRecord("piglut/gl_state_raw", STATE_DRAWS * 6, benchNow() - start);
+
+   start = benchNow();
+   for (i = 0; i < STATE_DRAWS; i++)
+   {
+      piglutUseProgram(pg, program);
+      piglutActiveTexture(pg, GL_TEXTURE0);
+      piglutBindTexture(pg, GL_TEXTURE_2D, texture);
+      piglutEnable(pg, GL_BLEND);
+      piglutBlendFunc(pg, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      piglutUniform4f(pg, color, 1.0f, 0.5f, 0.25f, 1.0f);
+   }
+   glFinish();
+   benchRecord("piglut/gl_state_cached", STATE_DRAWS * 6, benchNow() - start);
+
+   piglutDeleteTextures(pg, 1, &texture);
+   piglutDeleteProgram(pg, program);
+   piglutLeaveMainLoop(pg);
+}
+
+/* packets recorded in a random texture order, sorted on submit so each
+   texture is only bound once */
+static void commandLists(void *pg)
+{
+   static const GLfloat triangle[] = { -1.0f, -1.0f, 0.0f, 1.0f, 1.0f, -1.0f };
+   GLuint program = createProgram();
+   GLint color = glGetUniformLocation(program, "color");
+   GLuint textures[TEXTURES], buffer;
+   piglutCommandList_t *cl = piglutCommandListCreate();
+   double start;
+   int i;
+
+   glGenTextures(TEXTURES, textures);
+   glGenBuffers(1, &buffer);
+   glBindBuffer(GL_ARRAY_BUFFER, buffer);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+   glBindAttribLocation(program, 0, "position");
+   piglutLinkProgram(pg, program);
+   piglutInvalidateGLState(pg);
+
+   start = benchNow();
+   for (i = 0; i < PACKETS; i++)
+   {
+      GLfloat c[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+      unsigned int t = (i * 7919) % TEXTURES;
+
+      piglutCmdBegin(cl, t);
+      piglutCmdUseProgram(cl, program);
+      piglutCmdBindTexture(cl, GL_TEXTURE0, GL_TEXTURE_2D, textures[t]);
+      piglutCmdBindBuffer(cl, GL_ARRAY_BUFFER, buffer);
+      piglutCmdVertexAttribPointer(cl, 0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+      piglutCmdEnableVertexAttribArray(cl, 0);
+      piglutCmdUniform4fv(cl, color, c);
+      piglutCmdDrawArrays(cl, GL_TRIANGLES, 0, 3);
+   }
+   benchRecord("piglut/cmd_record", PACKETS, benchNow() - start);
+
+   start = benchNow();
+   piglutCommandListSubmit(pg, &cl, 1);
+   glFinish();
+   benchRecord("piglut/cmd_submit", PACKETS, benchNow() - start);
+
+   piglutCommandListDestroy(cl);
+   piglutDeleteBuffers(pg, 1, &buffer);
+   piglutDeleteTextures(pg, TEXTURES, textures);
+   piglutDeleteProgram(pg, program);
+   piglutLeaveMainLoop(pg);
+}
+
+static unsigned char resourcePixels[16 * 16 * 4];
+static int resources[RESOURCES];
+
+static int reloadTexture(void *pg, int resource, void *userData)
+{
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 16, 16, 0, GL_RGBA, GL_UNSIGNED_BYTE, resourcePixels);
+   return 0;
+}
+
+static void createResources(void *pg)
+{
+   int i;
+
+   for (i = 0; i < RESOURCES; i++)
+      resources[i] = piglutCreateTexture(pg, 16, 16, GL_RGBA, GL_UNSIGNED_BYTE,
+                                         resourcePixels, reloadTexture, NULL);
+}
+
+/* lookups of resident resources, the cost added to every bind */
+static void resourceUses(void *pg)
+{
+   double start;
+   unsigned int i;
+   GLuint sum = 0;
+
+   createResources(pg);
+
+   start = benchNow();
+   for (i = 0; i < RESOURCE_USES; i++)
+      sum += piglutUseResource(pg, resources[(i * 7919) % RESOURCES]);
+   benchRecord("piglut/resource_use", RESOURCE_USES, benchNow() - start);
+
+   benchSink = (float)sum;
+   piglutLeaveMainLoop(pg);
+}
+
+static void resourceChurnInit(void *pg)
+{
+   createResources(pg);
+   piglutSetGPUBudget(pg, RESOURCES / 2 * sizeof(resourcePixels));
+   startTime = benchNow();
+}
+
+/* a working set bigger than the budget, so most uses evict and reload */
+static void resourceChurn(void *pg)
+{
+   unsigned int i;
+
+   for (i = 0; i < RESOURCES_PER_FRAME; i++)
+      piglutUseResource(pg, resources[(counter * RESOURCES_PER_FRAME + i) % RESOURCES]);
+
+   if (++counter == RESOURCE_FRAMES)
+   {
+      glFinish();
+      benchRecord("piglut/resource_churn", RESOURCE_FRAMES * RESOURCES_PER_FRAME, benchNow() - startTime);
+      piglutLeaveMainLoop(pg);
+   }
+}
+
+static void startClock(void *pg)
+{
+   startTime = benchNow();
+}
+
+static void * create(void)
+{
+   void *pg = piglutInit(0, NULL);
+   piglutWindowConfig_t wc;
+
+   piglutInitWindowConfig(&wc);
+   wc.width = 64;
+   wc.height = 64;
+   piglutInitWindowSize(pg, &wc);
+   piglutInitFunc(pg, startClock);
+
+   counter = 0;
+   return pg;
+}
+
+static bool frameLoop(const char *name, displayCallback display, bool eventDriven)
+{
+   void *pg = create();
+   int result;
+
+   target = FRAMES;
+   piglutDisplayFunc(pg, display);
+   piglutSetEventDriven(pg, eventDriven);
+
+   result = piglutMainLoop(pg);
+   if (result == 0)
+      benchRecord(name, counter, endTime - startTime);
+
+   piglutTerm(pg);
+   return result == 0;
+}
+
+static void keyboardLoop(void)
+{
+   int fds[2];
+   int savedStdin = dup(STDIN_FILENO);
+   char keys[KEYS];
+   void *pg;
+   int i;
+
+   if ((savedStdin < 0) || pipe(fds))
+      return;
+
+   /* the whole batch fits in the pipe, so it's all waiting when the loop starts */
+   for (i = 0; i < KEYS; i++)
+      keys[i] = 'a' + (i % 26);
+   if (write(fds[1], keys, KEYS) == KEYS)
+   {
+      dup2(fds[0], STDIN_FILENO);
+
+      pg = create();
+      target = KEYS;
+      piglutKeyboardFunc(pg, countKey);
+      piglutSetEventDriven(pg, true);
+      if (piglutMainLoop(pg) == 0)
+         benchRecord("piglut/key", counter, endTime - startTime);
+      piglutTerm(pg);
+
+      dup2(savedStdin, STDIN_FILENO);
+   }
+
+   close(fds[0]);
+   close(fds[1]);
+   close(savedStdin);
+}
+
+void piglutBenchmarks(void)
+{
+   void *pg;
+
+   /* piglut overhead only, the callbacks don't touch GL */
+   if (!frameLoop("piglut/frame_continuous", emptyDisplay, false))
+   {
+      fprintf(stderr, "piglut: main loop failed to start, skipping\n");
+      return;
+   }
+   frameLoop("piglut/frame_event_driven", redisplayDisplay, true);
+
+   keyboardLoop();
+
+   pg = create();
+   piglutInitFunc(pg, selectConfigs);
+   piglutMainLoop(pg);
+   piglutTerm(pg);
+
+   pg = create();
+   piglutInitFunc(pg, glStateCalls);
+   piglutMainLoop(pg);
+   piglutTerm(pg);
+
+   pg = create();
+   piglutInitFunc(pg, commandLists);
+   piglutMainLoop(pg);
+   piglutTerm(pg);
+
+   pg = create();
+   piglutInitFunc(pg, resourceUses);
+   piglutMainLoop(pg);
+   piglutTerm(pg);
+
+   pg = create();
+   piglutInitFunc(pg, resourceChurnInit);
+   piglutDisplayFunc(pg, resourceChurn);
+   piglutMainLoop(pg);
+   piglutTerm(pg);
+
+   /* the empty frame loop again, plus the readback into the shared buffers */
+   pg = create();
+   target = EXPORT_FRAMES;
+   piglutDisplayFunc(pg, emptyDisplay);
+   if ((piglutExportFrames(pg, 0, EXPORT_BUFFERS) >= 0) && (piglutMainLoop(pg) == 0))
+      benchRecord("piglut/frame_export", counter, endTime - startTime);
+   piglutTerm(pg);
+}
@@ -0,0 +1,560 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* define ESCULL_NO_SIMD to force the portable path */
+#if defined(ESCULL_NO_SIMD)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ESCULL_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define ESCULL_SSE
+#endif
+
+#include "escull.h"
+
+/* boxes per leaf, small enough that testing each one is cheap */
+#define BVH_LEAF_SIZE 4
+#define BVH_MAX_DEPTH 64
+#define ALL_PLANES 0x3F
+
+typedef struct
+{
+   float center[3];
+   float extent[3];
+   /* range of bvh->indices covered by this subtree */
+   unsigned int start;
+   unsigned int count;
+   /* 0 for a leaf, otherwise the children are left and left + 1 */
+   unsigned int left;
+} bvhNode_t;
+
+struct ESBvh
+{
+   ESBoxArray boxes;
+   bvhNode_t *nodes;
+   unsigned int nodeCount;
+   unsigned int *indices;
+};
+
+static void setPlane(ESPlane *p, float a, float b, float c, float d)
+{
+   float length = sqrtf(a * a + b * b + c * c);
+   float rlength = (length > 0.0f) ? (1.0f / length) : 0.0f;
+
+   p->a = a * rlength;
+   p->b = b * rlength;
+   p->c = c * rlength;
+   p->d = d * rlength;
+}
+
+void esFrustumPlanesFromMatrix(ESFrustumPlanes *result, const ESMatrix *mvp)
+{
+   const float (*m)[4] = mvp->m;
+   int i;
+
+   /* m[i] is a column, so clip space row r is (m[0][r], m[1][r], m[2][r],
+      m[3][r]).  Each plane is row 3 plus or minus one of the others */
+   for (i = 0; i < 3; i++)
+   {
+      setPlane(&result->planes[i * 2],
+               m[0][3] + m[0][i], m[1][3] + m[1][i],
+               m[2][3] + m[2][i], m[3][3] + m[3][i]);
+      setPlane(&result->planes[(i * 2) + 1],
+               m[0][3] - m[0][i], m[1][3] - m[1][i],
+               m[2][3] - m[2][i], m[3][3] - m[3][i]);
+   }
+}
+
+static int boxVisible(const ESFrustumPlanes *f, float cx, float cy, float cz,
+                      float ex, float ey, float ez)
+{
+   int i;
+
+   for (i = 0; i < 6; i++)
+   {
+      const ESPlane *p = &f->planes[i];
+      float d = p->a * cx + p->b * cy + p->c * cz + p->d;
+      float r = fabsf(p->a) * ex + fabsf(p->b) * ey + fabsf(p->c) * ez;
+      if (d + r < 0.0f)
+         return 0;
+   }
+   return 1;
+}
+
+static int sphereVisible(const ESFrustumPlanes *f, float cx, float cy, float cz, float radius)
+{
+   int i;
+
+   for (i = 0; i < 6; i++)
+   {
+      const ESPlane *p = &f->planes[i];
+      if (p->a * cx + p->b * cy + p->c * cz + p->d < -radius)
+         return 0;
+   }
+   return 1;
+}
+
+/* the visible list is written unconditionally and the count only advanced
+   for hits, which avoids a hard to predict branch per object */
+static unsigned int cullBoxesScalar(const ESFrustumPlanes *f, const ESBoxArray *b,
+                                    unsigned int start, unsigned int *visible,
+                                    unsigned int n)
+{
+   unsigned int i;
+
+   for (i = start; i < b->count; i++)
+   {
+      visible[n] = i;
+      n += boxVisible(f, b->centerX[i], b->centerY[i], b->centerZ[i],
+                      b->extentX[i], b->extentY[i], b->extentZ[i]);
+   }
+   return n;
+}
+
+static unsigned int cullSpheresScalar(const ESFrustumPlanes *f, const ESSphereArray *s,
+                                      unsigned int start, unsigned int *visible,
+                                      unsigned int n)
+{
+   unsigned int i;
+
+   for (i = start; i < s->count; i++)
+   {
+      visible[n] = i;
+      n += sphereVisible(f, s->centerX[i], s->centerY[i], s->centerZ[i], s->radius[i]);
+   }
+   return n;
+}
+
+#if defined(ESCULL_SSE) || defined(ESCULL_NEON)
+
+static unsigned int emitMask(unsigned int *visible, unsigned int n,
+                             unsigned int base, unsigned int mask)
+{
+   visible[n] = base;
+   n += mask & 1;
+   visible[n] = base + 1;
+   n += (mask >> 1) & 1;
+   visible[n] = base + 2;
+   n += (mask >> 2) & 1;
+   visible[n] = base + 3;
+   n += (mask >> 3) & 1;
+   return n;
+}
+
+#endif
+
+#if defined(ESCULL_SSE)
+
+unsigned int esCullBoxes(const ESFrustumPlanes *f, const ESBoxArray *b, unsigned int *visible)
+{
+   const __m128 signMask = _mm_set1_ps(-0.0f);
+   unsigned int i, n = 0;
+
+   for (i = 0; i + 4 <= b->count; i += 4)
+   {
+      __m128 cx = _mm_loadu_ps(&b->centerX[i]);
+      __m128 cy = _mm_loadu_ps(&b->centerY[i]);
+      __m128 cz = _mm_loadu_ps(&b->centerZ[i]);
+      __m128 ex = _mm_loadu_ps(&b->extentX[i]);
+      __m128 ey = _mm_loadu_ps(&b->extentY[i]);
+      __m128 ez = _mm_loadu_ps(&b->extentZ[i]);
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      int j;
+
+      for (j = 0; j < 6; j++)
+      {
+         const ESPlane *p = &f->planes[j];
+         __m128 a = _mm_set1_ps(p->a);
+         __m128 bb = _mm_set1_ps(p->b);
+         __m128 c = _mm_set1_ps(p->c);
+         __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(bb, cy)),
+                               _mm_add_ps(_mm_mul_ps(c, cz), _mm_set1_ps(p->d)));
+         __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, a), ex),
+                                          _mm_mul_ps(_mm_andnot_ps(signMask, bb), ey)),
+                               _mm_mul_ps(_mm_andnot_ps(signMask, c), ez));
+         inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+      }
+
+      n = emitMask(visible, n, i, _mm_movemask_ps(inside));
+   }
+
+   return cullBoxesScalar(f, b, i, visible, n);
+}
+
+unsigned int esCullSpheres(const ESFrustumPlanes *f, const ESSphereArray *s, unsigned int *visible)
+{
+   unsigned int i, n = 0;
+
+   for (i = 0; i + 4 <= s->count; i += 4)
+   {
+      __m128 cx = _mm_loadu_ps(&s->centerX[i]);
+      __m128 cy = _mm_loadu_ps(&s->centerY[i]);
+      __m128 cz = _mm_loadu_ps(&s->centerZ[i]);
+      __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&s->radius[i]));
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      int j;
+
+      for (j = 0; j < 6; j++)
+      {
+         const ESPlane *p = &f->planes[j];
+         __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p->a), cx),
+                                          _mm_mul_ps(_mm_set1_ps(p->b), cy)),
+                               _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p->c), cz),
+                                          _mm_set1_ps(p->d)));
+         inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negRadius));
+      }
+
+      n = emitMask(visible, n, i, _mm_movemask_ps(inside));
+   }
+
+   return cullSpheresScalar(f, s, i, visible, n);
+}
+
+#elif defined(ESCULL_NEON)
+
+static unsigned int neonMask(uint32x4_t inside)
+{
+   return (vgetq_lane_u32(inside, 0) & 1) |
+          (vgetq_lane_u32(inside, 1) & 2) |
+          (vgetq_lane_u32(inside, 2) & 4) |
+          (vgetq_lane_u32(inside, 3) & 8);
+}
+
+unsigned int esCullBoxes(const ESFrustumPlanes *f, const ESBoxArray *b, unsigned int *visible)
+{
+   unsigned int i, n = 0;
+
+   for (i = 0; i + 4 <= b->count; i += 4)
+   {
+      float32x4_t cx = vld1q_f32(&b->centerX[i]);
+      float32x4_t cy = vld1q_f32(&b->centerY[i]);
+      float32x4_t cz = vld1q_f32(&b->centerZ[i]);
+      float32x4_t ex = vld1q_f32(&b->extentX[i]);
+      float32x4_t ey = vld1q_f32(&b->extentY[i]);
+      float32x4_t ez = vld1q_f32(&b->extentZ[i]);
+      uint32x4_t inside = vdupq_n_u32(~0U);
+      int j;
+
+      for (j = 0; j < 6; j++)
+      {
+         const ESPlane *p = &f->planes[j];
+         float32x4_t d = vdupq_n_f32(p->d);
+         d = vmlaq_n_f32(d, cx, p->a);
+         d = vmlaq_n_f32(d, cy, p->b);
+         d = vmlaq_n_f32(d, cz, p->c);
+         d = vmlaq_n_f32(d, ex, fabsf(p->a));
+         d = vmlaq_n_f32(d, ey, fabsf(p->b));
+         d = vmlaq_n_f32(d, ez, fabsf(p->c));
+         inside = vandq_u32(inside, vcgeq_f32(d, vdupq_n_f32(0.0f)));
+      }
+
+      n = emitMask(visible, n, i, neonMask(inside));
+   }
+
+   return cullBoxesScalar(f, b, i, visible, n);
+}
+
+unsigned int esCullSpheres(const ESFrustumPlanes *f, const ESSphereArray *s, unsigned int *visible)
+{
+   unsigned int i, n = 0;
+
+   for (i = 0; i + 4 <= s->count; i += 4)
+   {
+      float32x4_t cx = vld1q_f32(&s->centerX[i]);
+      float32x4_t cy = vld1q_f32(&s->centerY[i]);
+      float32x4_t cz = vld1q_f32(&s->centerZ[i]);
+      float32x4_t radius = vld1q_f32(&s->radius[i]);
+      uint32x4_t inside = vdupq_n_u32(~0U);
+      int j;
+
+      for (j = 0; j < 6; j++)
+      {
+         const ESPlane *p = &f->planes[j];
+         float32x4_t d = vaddq_f32(vdupq_n_f32(p->d), radius);
+         d = vmlaq_n_f32(d, cx, p->a);
+         d = vmlaq_n_f32(d, cy, p->b);
+         d = vmlaq_n_f32(d, cz, p->c);
+         inside = vandq_u32(inside, vcgeq_f32(d, vdupq_n_f32(0.0f)));
+      }
+
+      n = emitMask(visible, n, i, neonMask(inside));
+   }
+
+   return cullSpheresScalar(f, s, i, visible, n);
+}
+
+#else
+
+/* no SIMD (e.g. ARMv6 with VFP only) */
+unsigned int esCullBoxes(const ESFrustumPlanes *f, const ESBoxArray *b, unsigned int *visible)
+{
+   return cullBoxesScalar(f, b, 0, visible, 0);
+}
+
+unsigned int esCullSpheres(const ESFrustumPlanes *f, const ESSphereArray *s, unsigned int *visible)
+{
+   return cullSpheresScalar(f, s, 0, visible, 0);
+}
+
+#endif
+
+/* quickselect, leaves the k'th smallest key at idx[k] with everything
+   smaller before it */
+static void selectNth(unsigned int *idx, int n, int k, const float *key)
+{
+   int lo = 0, hi = n - 1;
+
+   while (lo < hi)
+   {
+      float pivot = key[idx[(lo + hi) / 2]];
+      int i = lo, j = hi;
+
+      while (i <= j)
+      {
+         while (key[idx[i]] < pivot)
+            i++;
+         while (key[idx[j]] > pivot)
+            j--;
+         if (i <= j)
+         {
+            unsigned int t = idx[i];
+            idx[i] = idx[j];
+            idx[j] = t;
+            i++;
+            j--;
+         }
+      }
+
+      if (k <= j)
+         hi = j;
+      else if (k >= i)
+         lo = i;
+      else
+         break;
+   }
+}
+
+static void build(ESBvh *bvh, unsigned int nodeIndex, unsigned int start, unsigned int count)
+{
+   const ESBoxArray *b = &bvh->boxes;
+   bvhNode_t *node = &bvh->nodes[nodeIndex];
+   const float *centers[3];
+   float lo[3], hi[3];
+   unsigned int i, axis;
+
+   node->start = start;
+   node->count = count;
+   node->left = 0;
+   if (count <= BVH_LEAF_SIZE)
+      return;
+
+   centers[0] = b->centerX;
+   centers[1] = b->centerY;
+   centers[2] = b->centerZ;
+
+   /* split at the median along the axis the centres are most spread on */
+   for (axis = 0; axis < 3; axis++)
+   {
+      lo[axis] = hi[axis] = centers[axis][bvh->indices[start]];
+      for (i = start + 1; i < start + count; i++)
+      {
+         float c = centers[axis][bvh->indices[i]];
+         lo[axis] = fminf(lo[axis], c);
+         hi[axis] = fmaxf(hi[axis], c);
+      }
+   }
+   axis = 0;
+   if (hi[1] - lo[1] > hi[axis] - lo[axis])
+      axis = 1;
+   if (hi[2] - lo[2] > hi[axis] - lo[axis])
+      axis = 2;
+
+   selectNth(&bvh->indices[start], count, count / 2, centers[axis]);
+
+   node->left = bvh->nodeCount;
+   bvh->nodeCount += 2;
+   build(bvh, node->left, start, count / 2);
+   build(bvh, node->left + 1, start + (count / 2), count - (count / 2));
+}
+
+ESBvh * esBvhCreate(const ESBoxArray *boxes)
+{
+   ESBvh *bvh = (ESBvh *)malloc(sizeof(ESBvh));
+   unsigned int i, maxNodes = (boxes->count > 0) ? (2 * boxes->count) : 1;
+
+   if (!bvh)
+      return NULL;
+
+   bvh->boxes = *boxes;
+   bvh->nodes = (bvhNode_t *)malloc(maxNodes * sizeof(bvhNode_t));
+   bvh->indices = (unsigned int *)malloc((boxes->count + 1) * sizeof(unsigned int));
+   if (!bvh->nodes || !bvh->indices)
+   {
+      esBvhDestroy(bvh);
+      return NULL;
+   }
+
+   for (i = 0; i < boxes->count; i++)
+      bvh->indices[i] = i;
+
+   bvh->nodeCount = 1;
+   build(bvh, 0, 0, boxes->count);
+   esBvhRefit(bvh, boxes);
+
+   return bvh;
+}
+
+void esBvhRefit(ESBvh *bvh, const ESBoxArray *boxes)
+{
+   const ESBoxArray *b;
+   int n;
+
+   bvh->boxes = *boxes;
+   b = &bvh->boxes;
+
+   /* children always come after their parent, so walking backwards
+      visits them first */
+   for (n = (int)bvh->nodeCount - 1; n >= 0; n--)
+   {
+      bvhNode_t *node = &bvh->nodes[n];
+      float lo[3], hi[3];
+      int axis;
+
+      if (node->left)
+      {
+         const bvhNode_t *l = &bvh->nodes[node->left];
+         const bvhNode_t *r = &bvh->nodes[node->left + 1];
+         for (axis = 0; axis < 3; axis++)
+         {
+            lo[axis] = fminf(l->center[axis] - l->extent[axis], r->center[axis] - r->extent[axis]);
+            hi[axis] = fmaxf(l->center[axis] + l->extent[axis], r->center[axis] + r->extent[axis]);
+         }
+      }
+      else if (node->count == 0)
+      {
+         lo[0] = lo[1] = lo[2] = 0.0f;
+         hi[0] = hi[1] = hi[2] = 0.0f;
+      }
+      else
+      {
+         unsigned int i;
+         for (i = 0; i < node->count; i++)
+         {
+            unsigned int k = bvh->indices[node->start + i];
+            float c[3], e[3];
+
+            c[0] = b->centerX[k];
+            c[1] = b->centerY[k];
+            c[2] = b->centerZ[k];
+            e[0] = b->extentX[k];
+            e[1] = b->extentY[k];
+            e[2] = b->extentZ[k];
+            for (axis = 0; axis < 3; axis++)
+            {
+               if ((i == 0) || (c[axis] - e[axis] < lo[axis]))
+                  lo[axis] = c[axis] - e[axis];
+               if ((i == 0) || (c[axis] + e[axis] > hi[axis]))
+                  hi[axis] = c[axis] + e[axis];
+            }
+         }
+      }
+
+      for (axis = 0; axis < 3; axis++)
+      {
+         node->center[axis] = (lo[axis] + hi[axis]) * 0.5f;
+         node->extent[axis] = (hi[axis] - lo[axis]) * 0.5f;
+      }
+   }
+}
+
+/* returns -1 if outside, otherwise the planes still straddled (0 when
+   entirely inside), only testing the planes in mask */
+static int classify(const ESFrustumPlanes *f, unsigned int mask,
+                    const float c[3], const float e[3])
+{
+   unsigned int i, straddled = 0;
+
+   for (i = 0; i < 6; i++)
+   {
+      const ESPlane *p;
+      float d, r;
+
+      if (!(mask & (1U << i)))
+         continue;
+
+      p = &f->planes[i];
+      d = p->a * c[0] + p->b * c[1] + p->c * c[2] + p->d;
+      r = fabsf(p->a) * e[0] + fabsf(p->b) * e[1] + fabsf(p->c) * e[2];
+      if (d + r < 0.0f)
+         return -1;
+      if (d - r < 0.0f)
+         straddled |= 1U << i;
+   }
+   return (int)straddled;
+}
+
+unsigned int esBvhCull(const ESBvh *bvh, const ESFrustumPlanes *f, unsigned int *visible)
+{
+   const ESBoxArray *b = &bvh->boxes;
+   unsigned int stack[BVH_MAX_DEPTH * 2];
+   unsigned int masks[BVH_MAX_DEPTH * 2];
+   unsigned int top = 0, n = 0;
+
+   if (b->count == 0)
+      return 0;
+
+   stack[top] = 0;
+   masks[top++] = ALL_PLANES;
+
+   while (top > 0)
+   {
+      const bvhNode_t *node;
+      int mask;
+
+      top--;
+      node = &bvh->nodes[stack[top]];
+      mask = classify(f, masks[top], node->center, node->extent);
+      if (mask < 0)
+         continue;
+
+      if (mask == 0)
+      {
+         /* wholly inside, the subtree's objects are contiguous */
+         memcpy(&visible[n], &bvh->indices[node->start], node->count * sizeof(unsigned int));
+         n += node->count;
+      }
+      else if (node->left)
+      {
+         /* planes the parent is inside of can't cut the children */
+         stack[top] = node->left;
+         masks[top++] = mask;
+         stack[top] = node->left + 1;
+         masks[top++] = mask;
+      }
+      else
+      {
+         unsigned int i;
+         for (i = 0; i < node->count; i++)
+         {
+            unsigned int k = bvh->indices[node->start + i];
+            visible[n] = k;
+            n += boxVisible(f, b->centerX[k], b->centerY[k], b->centerZ[k],
+                            b->extentX[k], b->extentY[k], b->extentZ[k]);
+         }
+      }
+   }
+
+   return n;
+}
+
+void esBvhDestroy(ESBvh *bvh)
+{
+   if (bvh)
+   {
+      free(bvh->nodes);
+      free(bvh->indices);
+      free(bvh);
+   }
+}
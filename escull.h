@@ -0,0 +1,60 @@
+#ifndef _ESCULL_H_
+#define _ESCULL_H_
+
+#include "esutil.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ax + by + cz + d >= 0 on the inside, normalised */
+typedef struct
+{
+   float a, b, c, d;
+} ESPlane;
+
+/* left, right, bottom, top, near, far */
+typedef struct
+{
+   ESPlane planes[6];
+} ESFrustumPlanes;
+
+/* axis aligned boxes as centre and half extent, structure of arrays so they
+   can be tested four at a time */
+typedef struct
+{
+   const float *centerX, *centerY, *centerZ;
+   const float *extentX, *extentY, *extentZ;
+   unsigned int count;
+} ESBoxArray;
+
+typedef struct
+{
+   const float *centerX, *centerY, *centerZ;
+   const float *radius;
+   unsigned int count;
+} ESSphereArray;
+
+typedef struct ESBvh ESBvh;
+
+/* extracts the planes from a combined model view projection matrix, as
+   built by esutil and passed to glUniformMatrix4fv() */
+void esFrustumPlanesFromMatrix(ESFrustumPlanes *result, const ESMatrix *mvp);
+
+/* write the indices of everything at least partly inside the frustum to
+   visible (which must have room for count entries) and return how many */
+unsigned int esCullBoxes(const ESFrustumPlanes *frustum, const ESBoxArray *boxes, unsigned int *visible);
+unsigned int esCullSpheres(const ESFrustumPlanes *frustum, const ESSphereArray *spheres, unsigned int *visible);
+
+/* bounding volume hierarchy over a set of boxes, for large mostly static
+   scenes.  Refit after boxes move, rebuild if they've moved a long way */
+ESBvh * esBvhCreate(const ESBoxArray *boxes);
+void esBvhRefit(ESBvh *bvh, const ESBoxArray *boxes);
+unsigned int esBvhCull(const ESBvh *bvh, const ESFrustumPlanes *frustum, unsigned int *visible);
+void esBvhDestroy(ESBvh *bvh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESCULL_H_ */
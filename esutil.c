@@ -2,6 +2,16 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+/* define ESUTIL_NO_SIMD to force the portable path */
+#if defined(ESUTIL_NO_SIMD)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ESUTIL_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define ESUTIL_SSE
+#endif
+
 #include "esutil.h"
 
 void esTranslate(ESMatrix *result, float tx, float ty, float tz)
@@ -317,3 +327,397 @@ void esLookAt(ESMatrix *result,
    esTranslate(result, -eyex, -eyey, -eyez);
 }
 
+
+void esQuaternionLoadIdentity(ESQuaternion *result)
+{
+   result->x = 0.0f;
+   result->y = 0.0f;
+   result->z = 0.0f;
+   result->w = 1.0f;
+}
+
+void esQuaternionFromAxisAngle(ESQuaternion *result, float angle, float x, float y, float z)
+{
+   float mag = sqrtf(x * x + y * y + z * z);
+   float halfAngle = angle * ((float)M_PI / 360.0f);
+   float s;
+
+   if (mag <= 0.0f)
+   {
+      esQuaternionLoadIdentity(result);
+      return;
+   }
+
+   s = sinf(halfAngle) / mag;
+   result->x = x * s;
+   result->y = y * s;
+   result->z = z * s;
+   result->w = cosf(halfAngle);
+}
+
+void esQuaternionMultiply(ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b)
+{
+   ESQuaternion tmp;
+
+   tmp.x = a->w * b->x + a->x * b->w + a->y * b->z - a->z * b->y;
+   tmp.y = a->w * b->y - a->x * b->z + a->y * b->w + a->z * b->x;
+   tmp.z = a->w * b->z + a->x * b->y - a->y * b->x + a->z * b->w;
+   tmp.w = a->w * b->w - a->x * b->x - a->y * b->y - a->z * b->z;
+
+   *result = tmp;
+}
+
+void esQuaternionNormalize(ESQuaternion *q)
+{
+   float mag = sqrtf(q->x * q->x + q->y * q->y + q->z * q->z + q->w * q->w);
+
+   if (mag > 0.0f)
+   {
+      float rmag = 1.0f / mag;
+
+      q->x *= rmag;
+      q->y *= rmag;
+      q->z *= rmag;
+      q->w *= rmag;
+   }
+}
+
+static float quaternionDot(const ESQuaternion *a, const ESQuaternion *b)
+{
+   return a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w;
+}
+
+void esQuaternionNlerp(ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b, float t)
+{
+   /* q and -q are the same rotation, take the short way round */
+   float tb = quaternionDot(a, b) < 0.0f ? -t : t;
+   float ta = 1.0f - t;
+
+   result->x = a->x * ta + b->x * tb;
+   result->y = a->y * ta + b->y * tb;
+   result->z = a->z * ta + b->z * tb;
+   result->w = a->w * ta + b->w * tb;
+   esQuaternionNormalize(result);
+}
+
+void esQuaternionSlerp(ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b, float t)
+{
+   float cosTheta = quaternionDot(a, b);
+   float sign = 1.0f;
+   float theta, sinTheta, ta, tb;
+
+   if (cosTheta < 0.0f)
+   {
+      cosTheta = -cosTheta;
+      sign = -1.0f;
+   }
+
+   /* nearly parallel, sin(theta) vanishes and nlerp is just as accurate */
+   if (cosTheta > 0.9995f)
+   {
+      esQuaternionNlerp(result, a, b, t);
+      return;
+   }
+
+   theta = acosf(cosTheta);
+   sinTheta = sinf(theta);
+   ta = sinf((1.0f - t) * theta) / sinTheta;
+   tb = sign * sinf(t * theta) / sinTheta;
+
+   result->x = a->x * ta + b->x * tb;
+   result->y = a->y * ta + b->y * tb;
+   result->z = a->z * ta + b->z * tb;
+   result->w = a->w * ta + b->w * tb;
+}
+
+/* upper 3x3 of the rotation, scaled so non unit quaternions still give a
+   pure rotation */
+static void quaternionToRotation(float rot[3][3], const ESQuaternion *q)
+{
+   float norm = quaternionDot(q, q);
+   float s = norm > 0.0f ? 2.0f / norm : 0.0f;
+   float xs = q->x * s, ys = q->y * s, zs = q->z * s;
+   float wx = q->w * xs, wy = q->w * ys, wz = q->w * zs;
+   float xx = q->x * xs, xy = q->x * ys, xz = q->x * zs;
+   float yy = q->y * ys, yz = q->y * zs, zz = q->z * zs;
+
+   rot[0][0] = 1.0f - (yy + zz);
+   rot[0][1] = xy + wz;
+   rot[0][2] = xz - wy;
+
+   rot[1][0] = xy - wz;
+   rot[1][1] = 1.0f - (xx + zz);
+   rot[1][2] = yz + wx;
+
+   rot[2][0] = xz + wy;
+   rot[2][1] = yz - wx;
+   rot[2][2] = 1.0f - (xx + yy);
+}
+
+void esQuaternionToMatrix(ESMatrix *result, const ESQuaternion *q)
+{
+   float rot[3][3];
+   int i;
+
+   quaternionToRotation(rot, q);
+   for (i=0; i<3; i++)
+   {
+      result->m[i][0] = rot[i][0];
+      result->m[i][1] = rot[i][1];
+      result->m[i][2] = rot[i][2];
+      result->m[i][3] = 0.0f;
+   }
+   result->m[3][0] = 0.0f;
+   result->m[3][1] = 0.0f;
+   result->m[3][2] = 0.0f;
+   result->m[3][3] = 1.0f;
+}
+
+void esRotateQuaternion(ESMatrix *result, const ESQuaternion *q)
+{
+   float rot[3][3];
+   ESMatrix tmp;
+   int i, j;
+
+   quaternionToRotation(rot, q);
+
+   /* rot has no translation or projection terms, so row 3 of the product
+      is result's own and the rest only need three products each */
+   for (i=0; i<3; i++)
+   {
+      for (j=0; j<4; j++)
+      {
+         tmp.m[i][j] = (rot[i][0] * result->m[0][j]) +
+                       (rot[i][1] * result->m[1][j]) +
+                       (rot[i][2] * result->m[2][j]);
+      }
+   }
+   memcpy(result->m, tmp.m, sizeof(float) * 12);
+}
+
+void esDualQuaternionLoadIdentity(ESDualQuaternion *result)
+{
+   esQuaternionLoadIdentity(&result->real);
+   result->dual.x = 0.0f;
+   result->dual.y = 0.0f;
+   result->dual.z = 0.0f;
+   result->dual.w = 0.0f;
+}
+
+void esDualQuaternionFromRotationTranslation(ESDualQuaternion *result, const ESQuaternion *rotation, float tx, float ty, float tz)
+{
+   ESQuaternion t;
+
+   /* dual = t * real / 2 with t a pure quaternion */
+   t.x = tx * 0.5f;
+   t.y = ty * 0.5f;
+   t.z = tz * 0.5f;
+   t.w = 0.0f;
+
+   result->real = *rotation;
+   esQuaternionMultiply(&result->dual, &t, rotation);
+}
+
+void esDualQuaternionMultiply(ESDualQuaternion *result, const ESDualQuaternion *a, const ESDualQuaternion *b)
+{
+   ESQuaternion real, dual, cross;
+
+   esQuaternionMultiply(&real, &a->real, &b->real);
+   esQuaternionMultiply(&dual, &a->real, &b->dual);
+   esQuaternionMultiply(&cross, &a->dual, &b->real);
+
+   result->real = real;
+   result->dual.x = dual.x + cross.x;
+   result->dual.y = dual.y + cross.y;
+   result->dual.z = dual.z + cross.z;
+   result->dual.w = dual.w + cross.w;
+}
+
+void esDualQuaternionNormalize(ESDualQuaternion *dq)
+{
+   float mag = sqrtf(quaternionDot(&dq->real, &dq->real));
+
+   if (mag > 0.0f)
+   {
+      float rmag = 1.0f / mag;
+
+      dq->real.x *= rmag;
+      dq->real.y *= rmag;
+      dq->real.z *= rmag;
+      dq->real.w *= rmag;
+      dq->dual.x *= rmag;
+      dq->dual.y *= rmag;
+      dq->dual.z *= rmag;
+      dq->dual.w *= rmag;
+   }
+}
+
+void esDualQuaternionBlend(ESDualQuaternion *result, const ESDualQuaternion *a, const ESDualQuaternion *b, float t)
+{
+   float tb = quaternionDot(&a->real, &b->real) < 0.0f ? -t : t;
+   float ta = 1.0f - t;
+
+   result->real.x = a->real.x * ta + b->real.x * tb;
+   result->real.y = a->real.y * ta + b->real.y * tb;
+   result->real.z = a->real.z * ta + b->real.z * tb;
+   result->real.w = a->real.w * ta + b->real.w * tb;
+   result->dual.x = a->dual.x * ta + b->dual.x * tb;
+   result->dual.y = a->dual.y * ta + b->dual.y * tb;
+   result->dual.z = a->dual.z * ta + b->dual.z * tb;
+   result->dual.w = a->dual.w * ta + b->dual.w * tb;
+   esDualQuaternionNormalize(result);
+}
+
+void esDualQuaternionToMatrix(ESMatrix *result, const ESDualQuaternion *dq)
+{
+   const ESQuaternion *r = &dq->real;
+   const ESQuaternion *d = &dq->dual;
+   float norm = quaternionDot(r, r);
+   float s = norm > 0.0f ? 2.0f / norm : 0.0f;
+
+   esQuaternionToMatrix(result, r);
+
+   /* translation = 2 * dual * conjugate(real) */
+   result->m[3][0] = s * (-d->w * r->x + d->x * r->w - d->y * r->z + d->z * r->y);
+   result->m[3][1] = s * (-d->w * r->y + d->x * r->z + d->y * r->w - d->z * r->x);
+   result->m[3][2] = s * (-d->w * r->z - d->x * r->y + d->y * r->x + d->z * r->w);
+}
+
+#if defined(ESUTIL_SSE) || defined(ESUTIL_NEON)
+
+#if defined(ESUTIL_SSE)
+typedef __m128 vec4_t;
+#define vecLoad(p)      _mm_loadu_ps(p)
+#define vecStore(p, v)  _mm_storeu_ps(p, v)
+#define vecSet(f)       _mm_set1_ps(f)
+#define vecAdd(a, b)    _mm_add_ps(a, b)
+#define vecSub(a, b)    _mm_sub_ps(a, b)
+#define vecMul(a, b)    _mm_mul_ps(a, b)
+#define vecTranspose(a, b, c, d) _MM_TRANSPOSE4_PS(a, b, c, d)
+/* the palette feeds the gpu, full precision division isn't worth it but
+   one newton step is */
+static inline vec4_t vecRecip(vec4_t v)
+{
+   vec4_t r = _mm_rcp_ps(v);
+   return _mm_sub_ps(_mm_add_ps(r, r), _mm_mul_ps(v, _mm_mul_ps(r, r)));
+}
+#else
+typedef float32x4_t vec4_t;
+#define vecLoad(p)      vld1q_f32(p)
+#define vecStore(p, v)  vst1q_f32(p, v)
+#define vecSet(f)       vdupq_n_f32(f)
+#define vecAdd(a, b)    vaddq_f32(a, b)
+#define vecSub(a, b)    vsubq_f32(a, b)
+#define vecMul(a, b)    vmulq_f32(a, b)
+#define vecTranspose(a, b, c, d) \
+   do { \
+      float32x4x2_t ab = vtrnq_f32(a, b); \
+      float32x4x2_t cd = vtrnq_f32(c, d); \
+      a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0])); \
+      b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1])); \
+      c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0])); \
+      d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1])); \
+   } while (0)
+static inline vec4_t vecRecip(vec4_t v)
+{
+   /* the estimate is only 8 bits, so two steps */
+   vec4_t r = vrecpeq_f32(v);
+   r = vmulq_f32(r, vrecpsq_f32(v, r));
+   return vmulq_f32(r, vrecpsq_f32(v, r));
+}
+#endif
+
+/* four joints per call, quaternion components are spread across lanes so
+   the arithmetic matches esDualQuaternionToMatrix() term for term */
+static void buildPalette4(ESMatrix *palette, const ESDualQuaternion *joints)
+{
+   vec4_t rx = vecLoad(&joints[0].real.x);
+   vec4_t ry = vecLoad(&joints[1].real.x);
+   vec4_t rz = vecLoad(&joints[2].real.x);
+   vec4_t rw = vecLoad(&joints[3].real.x);
+   vec4_t dx = vecLoad(&joints[0].dual.x);
+   vec4_t dy = vecLoad(&joints[1].dual.x);
+   vec4_t dz = vecLoad(&joints[2].dual.x);
+   vec4_t dw = vecLoad(&joints[3].dual.x);
+   vec4_t one = vecSet(1.0f);
+   vec4_t zero = vecSet(0.0f);
+   vec4_t s, xs, ys, zs, wx, wy, wz, xx, xy, xz, yy, yz, zz;
+   vec4_t c0x, c0y, c0z, c1x, c1y, c1z, c2x, c2y, c2z, tx, ty, tz, c3w;
+
+   vecTranspose(rx, ry, rz, rw);
+   vecTranspose(dx, dy, dz, dw);
+
+   s = vecAdd(vecAdd(vecMul(rx, rx), vecMul(ry, ry)), vecAdd(vecMul(rz, rz), vecMul(rw, rw)));
+   s = vecAdd(vecRecip(s), vecRecip(s));
+
+   xs = vecMul(rx, s);
+   ys = vecMul(ry, s);
+   zs = vecMul(rz, s);
+   wx = vecMul(rw, xs);
+   wy = vecMul(rw, ys);
+   wz = vecMul(rw, zs);
+   xx = vecMul(rx, xs);
+   xy = vecMul(rx, ys);
+   xz = vecMul(rx, zs);
+   yy = vecMul(ry, ys);
+   yz = vecMul(ry, zs);
+   zz = vecMul(rz, zs);
+
+   c0x = vecSub(one, vecAdd(yy, zz));
+   c0y = vecAdd(xy, wz);
+   c0z = vecSub(xz, wy);
+   c1x = vecSub(xy, wz);
+   c1y = vecSub(one, vecAdd(xx, zz));
+   c1z = vecAdd(yz, wx);
+   c2x = vecAdd(xz, wy);
+   c2y = vecSub(yz, wx);
+   c2z = vecSub(one, vecAdd(xx, yy));
+
+   tx = vecAdd(vecSub(vecMul(dx, rw), vecMul(dw, rx)), vecSub(vecMul(dz, ry), vecMul(dy, rz)));
+   ty = vecAdd(vecSub(vecMul(dx, rz), vecMul(dw, ry)), vecSub(vecMul(dy, rw), vecMul(dz, rx)));
+   tz = vecAdd(vecSub(vecMul(dy, rx), vecMul(dw, rz)), vecSub(vecMul(dz, rw), vecMul(dx, ry)));
+   tx = vecMul(tx, s);
+   ty = vecMul(ty, s);
+   tz = vecMul(tz, s);
+   c3w = one;
+
+   /* back to one matrix column per lane */
+   vecTranspose(c0x, c0y, c0z, zero);
+   vecStore(palette[0].m[0], c0x);
+   vecStore(palette[1].m[0], c0y);
+   vecStore(palette[2].m[0], c0z);
+   vecStore(palette[3].m[0], zero);
+
+   zero = vecSet(0.0f);
+   vecTranspose(c1x, c1y, c1z, zero);
+   vecStore(palette[0].m[1], c1x);
+   vecStore(palette[1].m[1], c1y);
+   vecStore(palette[2].m[1], c1z);
+   vecStore(palette[3].m[1], zero);
+
+   zero = vecSet(0.0f);
+   vecTranspose(c2x, c2y, c2z, zero);
+   vecStore(palette[0].m[2], c2x);
+   vecStore(palette[1].m[2], c2y);
+   vecStore(palette[2].m[2], c2z);
+   vecStore(palette[3].m[2], zero);
+
+   vecTranspose(tx, ty, tz, c3w);
+   vecStore(palette[0].m[3], tx);
+   vecStore(palette[1].m[3], ty);
+   vecStore(palette[2].m[3], tz);
+   vecStore(palette[3].m[3], c3w);
+}
+#endif
+
+void esBuildSkinningPalette(ESMatrix *palette, const ESDualQuaternion *joints, unsigned int count)
+{
+   unsigned int i = 0;
+
+#if defined(ESUTIL_SSE) || defined(ESUTIL_NEON)
+   for (; i + 4 <= count; i += 4)
+      buildPalette4(&palette[i], &joints[i]);
+#endif
+   for (; i < count; i++)
+      esDualQuaternionToMatrix(&palette[i], &joints[i]);
+}
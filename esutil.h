@@ -15,6 +15,19 @@ typedef struct
    float m[3][3];
 } ESMatrix3;
 
+/* unit quaternion rotation, w is the scalar part */
+typedef struct
+{
+   float x, y, z, w;
+} ESQuaternion;
+
+/* rigid transform, rotation in real and translation folded into dual */
+typedef struct
+{
+   ESQuaternion real;
+   ESQuaternion dual;
+} ESDualQuaternion;
+
 void esTranslate(ESMatrix *result, float tx, float ty, float tz);
 void esScale(ESMatrix *result, float sx, float sy, float sz);
 void esMatrixMultiply(ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB);
@@ -26,6 +39,29 @@ void esPerspective(ESMatrix *result, float fovy, float aspect, float zNear, floa
 void esOrtho(ESMatrix *result, float left, float right, float bottom, float top, float nearZ, float farZ);
 void esLookAt(ESMatrix *result, float eyex, float eyey, float eyez, float centerx, float centery, float centerz, float upx, float upy, float upz);
 
+/* angles are in degrees, as for esRotate().  Products apply b first, then a */
+void esQuaternionLoadIdentity(ESQuaternion *result);
+void esQuaternionFromAxisAngle(ESQuaternion *result, float angle, float x, float y, float z);
+void esQuaternionMultiply(ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b);
+void esQuaternionNormalize(ESQuaternion *q);
+void esQuaternionNlerp(ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b, float t);
+void esQuaternionSlerp(ESQuaternion *result, const ESQuaternion *a, const ESQuaternion *b, float t);
+void esQuaternionToMatrix(ESMatrix *result, const ESQuaternion *q);
+/* same as esRotate(), but from a quaternion and without the full multiply */
+void esRotateQuaternion(ESMatrix *result, const ESQuaternion *q);
+
+void esDualQuaternionLoadIdentity(ESDualQuaternion *result);
+void esDualQuaternionFromRotationTranslation(ESDualQuaternion *result, const ESQuaternion *rotation, float tx, float ty, float tz);
+void esDualQuaternionMultiply(ESDualQuaternion *result, const ESDualQuaternion *a, const ESDualQuaternion *b);
+void esDualQuaternionNormalize(ESDualQuaternion *dq);
+/* normalised linear blend along the shortest path */
+void esDualQuaternionBlend(ESDualQuaternion *result, const ESDualQuaternion *a, const ESDualQuaternion *b, float t);
+void esDualQuaternionToMatrix(ESMatrix *result, const ESDualQuaternion *dq);
+
+/* converts count joint transforms to bone matrices, four at a time where
+   SSE or NEON are available.  Joints needn't be exactly unit length */
+void esBuildSkinningPalette(ESMatrix *palette, const ESDualQuaternion *joints, unsigned int count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,403 @@
+#ifndef _ESUTIL_HPP_
+#define _ESUTIL_HPP_
+
+/* optional header only C++ layer over esutil.  Each transform type only
+   stores and multiplies the terms it can have, so composing a translation
+   with a rotation costs a handful of multiplies rather than a full 4x4, and
+   constant transforms built from constexpr values fold at compile time.
+
+   Products follow the usual column vector convention, a * b applies b first
+   and then a.  m * es::translation(x, y, z) is the same as
+   esTranslate(&m, x, y, z), and a * b as esMatrixMultiply(&r, &b, &a).
+
+   Everything converts to a Projective, which holds a plain ESMatrix that can
+   be handed to the C functions and glUniformMatrix4fv() directly */
+
+#if !defined(__cplusplus) || (__cplusplus < 201402L)
+#error "esutil.hpp needs C++14"
+#endif
+
+#include <math.h>
+
+#include "esutil.h"
+
+namespace es
+{
+
+/* the identity, composes away entirely */
+struct Identity
+{
+};
+
+struct Translation
+{
+   float x, y, z;
+};
+
+/* 3x3, stored column major like ESMatrix */
+struct Rotation
+{
+   float m[3][3];
+};
+
+/* 3x3 linear part in columns 0 to 2, translation in column 3 */
+struct Affine
+{
+   float m[4][3];
+};
+
+struct Projective
+{
+   ESMatrix matrix;
+
+   const ESMatrix *get() const { return &matrix; }
+   const float *data() const { return &matrix.m[0][0]; }
+};
+
+static_assert(sizeof(Projective) == sizeof(ESMatrix), "Projective must stay layout compatible with ESMatrix");
+
+/* construction */
+
+constexpr Translation translation(float x, float y, float z)
+{
+   return Translation{x, y, z};
+}
+
+constexpr Rotation rotation(const ESQuaternion &q)
+{
+   float norm = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+   float s = norm > 0.0f ? 2.0f / norm : 0.0f;
+   float xs = q.x * s, ys = q.y * s, zs = q.z * s;
+   float wx = q.w * xs, wy = q.w * ys, wz = q.w * zs;
+   float xx = q.x * xs, xy = q.x * ys, xz = q.x * zs;
+   float yy = q.y * ys, yz = q.y * zs, zz = q.z * zs;
+
+   return Rotation{{{1.0f - (yy + zz), xy + wz, xz - wy},
+                    {xy - wz, 1.0f - (xx + zz), yz + wx},
+                    {xz + wy, yz - wx, 1.0f - (xx + yy)}}};
+}
+
+/* degrees, as for esRotate().  Needs the trig functions, so not constexpr */
+inline Rotation rotation(float angle, float x, float y, float z)
+{
+   ESQuaternion q;
+
+   esQuaternionFromAxisAngle(&q, angle, x, y, z);
+   return rotation(q);
+}
+
+constexpr Affine scale(float sx, float sy, float sz)
+{
+   return Affine{{{sx, 0.0f, 0.0f},
+                  {0.0f, sy, 0.0f},
+                  {0.0f, 0.0f, sz},
+                  {0.0f, 0.0f, 0.0f}}};
+}
+
+/* an orthographic projection is only a scale and offset, so it stays affine
+   and multiplies like one.  Degenerate volumes give the identity, where
+   esOrtho() would leave the matrix alone */
+constexpr Affine ortho(float left, float right, float bottom, float top, float nearZ, float farZ)
+{
+   float deltaX = right - left;
+   float deltaY = top - bottom;
+   float deltaZ = farZ - nearZ;
+
+   if ((deltaX == 0.0f) || (deltaY == 0.0f) || (deltaZ == 0.0f))
+      return scale(1.0f, 1.0f, 1.0f);
+
+   return Affine{{{2.0f / deltaX, 0.0f, 0.0f},
+                  {0.0f, 2.0f / deltaY, 0.0f},
+                  {0.0f, 0.0f, -2.0f / deltaZ},
+                  {-(right + left) / deltaX, -(top + bottom) / deltaY, -(nearZ + farZ) / deltaZ}}};
+}
+
+constexpr Projective frustum(float left, float right, float bottom, float top, float nearZ, float farZ)
+{
+   float deltaX = right - left;
+   float deltaY = top - bottom;
+   float deltaZ = farZ - nearZ;
+
+   if ((nearZ <= 0.0f) || (farZ <= 0.0f) ||
+       (deltaX <= 0.0f) || (deltaY <= 0.0f) || (deltaZ <= 0.0f))
+      return Projective{{{{1.0f, 0.0f, 0.0f, 0.0f},
+                          {0.0f, 1.0f, 0.0f, 0.0f},
+                          {0.0f, 0.0f, 1.0f, 0.0f},
+                          {0.0f, 0.0f, 0.0f, 1.0f}}}};
+
+   return Projective{{{{2.0f * nearZ / deltaX, 0.0f, 0.0f, 0.0f},
+                       {0.0f, 2.0f * nearZ / deltaY, 0.0f, 0.0f},
+                       {(right + left) / deltaX, (top + bottom) / deltaY, -(nearZ + farZ) / deltaZ, -1.0f},
+                       {0.0f, 0.0f, -2.0f * nearZ * farZ / deltaZ, 0.0f}}}};
+}
+
+inline Projective perspective(float fovy, float aspect, float zNear, float zFar)
+{
+   float radians = fovy * (3.14159265358979f / 360.0f);
+   float deltaZ = zFar - zNear;
+   float sine = sinf(radians);
+   float cotangent;
+
+   if ((deltaZ == 0) || (sine == 0) || (aspect == 0))
+      return frustum(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+
+   cotangent = cosf(radians) / sine;
+   return Projective{{{{cotangent / aspect, 0.0f, 0.0f, 0.0f},
+                       {0.0f, cotangent, 0.0f, 0.0f},
+                       {0.0f, 0.0f, -(zFar + zNear) / deltaZ, -1.0f},
+                       {0.0f, 0.0f, -2.0f * zNear * zFar / deltaZ, 0.0f}}}};
+}
+
+/* widening, each type converts to any more general one */
+
+constexpr Affine toAffine(const Translation &t)
+{
+   return Affine{{{1.0f, 0.0f, 0.0f},
+                  {0.0f, 1.0f, 0.0f},
+                  {0.0f, 0.0f, 1.0f},
+                  {t.x, t.y, t.z}}};
+}
+
+constexpr Affine toAffine(const Rotation &r)
+{
+   return Affine{{{r.m[0][0], r.m[0][1], r.m[0][2]},
+                  {r.m[1][0], r.m[1][1], r.m[1][2]},
+                  {r.m[2][0], r.m[2][1], r.m[2][2]},
+                  {0.0f, 0.0f, 0.0f}}};
+}
+
+constexpr const Affine &toAffine(const Affine &a)
+{
+   return a;
+}
+
+constexpr Projective toProjective(const Affine &a)
+{
+   return Projective{{{{a.m[0][0], a.m[0][1], a.m[0][2], 0.0f},
+                       {a.m[1][0], a.m[1][1], a.m[1][2], 0.0f},
+                       {a.m[2][0], a.m[2][1], a.m[2][2], 0.0f},
+                       {a.m[3][0], a.m[3][1], a.m[3][2], 1.0f}}}};
+}
+
+constexpr Projective toProjective(const Translation &t)
+{
+   return toProjective(toAffine(t));
+}
+
+constexpr Projective toProjective(const Rotation &r)
+{
+   return toProjective(toAffine(r));
+}
+
+constexpr const Projective &toProjective(const Projective &p)
+{
+   return p;
+}
+
+constexpr Projective toProjective(const ESMatrix &m)
+{
+   return Projective{m};
+}
+
+/* composition, specialised for each pair so no term that is known to be
+   zero or one is ever multiplied */
+
+/* out = a * v over the 3x3 linear part, written out so it's straight line
+   code whatever the optimiser makes of the loops around it */
+constexpr void linear3(float out[3], const float (*a)[3], const float v[3])
+{
+   out[0] = a[0][0] * v[0] + a[1][0] * v[1] + a[2][0] * v[2];
+   out[1] = a[0][1] * v[0] + a[1][1] * v[1] + a[2][1] * v[2];
+   out[2] = a[0][2] * v[0] + a[1][2] * v[1] + a[2][2] * v[2];
+}
+
+constexpr void linear4(float out[4], const float (*a)[4], const float v[3])
+{
+   out[0] = a[0][0] * v[0] + a[1][0] * v[1] + a[2][0] * v[2];
+   out[1] = a[0][1] * v[0] + a[1][1] * v[1] + a[2][1] * v[2];
+   out[2] = a[0][2] * v[0] + a[1][2] * v[1] + a[2][2] * v[2];
+   out[3] = a[0][3] * v[0] + a[1][3] * v[1] + a[2][3] * v[2];
+}
+
+template <typename T>
+constexpr const T &operator*(const T &a, const Identity &)
+{
+   return a;
+}
+
+template <typename T>
+constexpr const T &operator*(const Identity &, const T &b)
+{
+   return b;
+}
+
+constexpr Identity operator*(const Identity &, const Identity &)
+{
+   return Identity{};
+}
+
+constexpr Translation operator*(const Translation &a, const Translation &b)
+{
+   return Translation{a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+constexpr Rotation operator*(const Rotation &a, const Rotation &b)
+{
+   Rotation r{};
+
+   linear3(r.m[0], a.m, b.m[0]);
+   linear3(r.m[1], a.m, b.m[1]);
+   linear3(r.m[2], a.m, b.m[2]);
+   return r;
+}
+
+constexpr Affine operator*(const Rotation &a, const Translation &b)
+{
+   Affine r = toAffine(a);
+   const float t[3] = {b.x, b.y, b.z};
+
+   linear3(r.m[3], a.m, t);
+   return r;
+}
+
+constexpr Affine operator*(const Translation &a, const Rotation &b)
+{
+   return Affine{{{b.m[0][0], b.m[0][1], b.m[0][2]},
+                  {b.m[1][0], b.m[1][1], b.m[1][2]},
+                  {b.m[2][0], b.m[2][1], b.m[2][2]},
+                  {a.x, a.y, a.z}}};
+}
+
+constexpr Affine operator*(const Affine &a, const Translation &b)
+{
+   Affine r = a;
+   const float t[3] = {b.x, b.y, b.z};
+
+   linear3(r.m[3], a.m, t);
+   r.m[3][0] += a.m[3][0];
+   r.m[3][1] += a.m[3][1];
+   r.m[3][2] += a.m[3][2];
+   return r;
+}
+
+constexpr Affine operator*(const Translation &a, const Affine &b)
+{
+   Affine r = b;
+
+   r.m[3][0] += a.x;
+   r.m[3][1] += a.y;
+   r.m[3][2] += a.z;
+   return r;
+}
+
+constexpr Affine operator*(const Affine &a, const Rotation &b)
+{
+   Affine r{};
+
+   linear3(r.m[0], a.m, b.m[0]);
+   linear3(r.m[1], a.m, b.m[1]);
+   linear3(r.m[2], a.m, b.m[2]);
+   r.m[3][0] = a.m[3][0];
+   r.m[3][1] = a.m[3][1];
+   r.m[3][2] = a.m[3][2];
+   return r;
+}
+
+constexpr Affine operator*(const Rotation &a, const Affine &b)
+{
+   Affine r{};
+
+   linear3(r.m[0], a.m, b.m[0]);
+   linear3(r.m[1], a.m, b.m[1]);
+   linear3(r.m[2], a.m, b.m[2]);
+   linear3(r.m[3], a.m, b.m[3]);
+   return r;
+}
+
+constexpr Affine operator*(const Affine &a, const Affine &b)
+{
+   Affine r{};
+
+   linear3(r.m[0], a.m, b.m[0]);
+   linear3(r.m[1], a.m, b.m[1]);
+   linear3(r.m[2], a.m, b.m[2]);
+   linear3(r.m[3], a.m, b.m[3]);
+   r.m[3][0] += a.m[3][0];
+   r.m[3][1] += a.m[3][1];
+   r.m[3][2] += a.m[3][2];
+   return r;
+}
+
+constexpr Projective operator*(const Projective &a, const Affine &b)
+{
+   Projective r{};
+
+   linear4(r.matrix.m[0], a.matrix.m, b.m[0]);
+   linear4(r.matrix.m[1], a.matrix.m, b.m[1]);
+   linear4(r.matrix.m[2], a.matrix.m, b.m[2]);
+   linear4(r.matrix.m[3], a.matrix.m, b.m[3]);
+   r.matrix.m[3][0] += a.matrix.m[3][0];
+   r.matrix.m[3][1] += a.matrix.m[3][1];
+   r.matrix.m[3][2] += a.matrix.m[3][2];
+   r.matrix.m[3][3] += a.matrix.m[3][3];
+   return r;
+}
+
+constexpr Projective operator*(const Affine &a, const Projective &b)
+{
+   Projective r{};
+
+   for (int c = 0; c < 4; c++)
+   {
+      for (int i = 0; i < 3; i++)
+         r.matrix.m[c][i] = a.m[0][i] * b.matrix.m[c][0] + a.m[1][i] * b.matrix.m[c][1] +
+                            a.m[2][i] * b.matrix.m[c][2] + a.m[3][i] * b.matrix.m[c][3];
+      r.matrix.m[c][3] = b.matrix.m[c][3];
+   }
+   return r;
+}
+
+constexpr Projective operator*(const Projective &a, const Projective &b)
+{
+   Projective r{};
+
+   for (int c = 0; c < 4; c++)
+      for (int i = 0; i < 4; i++)
+         r.matrix.m[c][i] = a.matrix.m[0][i] * b.matrix.m[c][0] + a.matrix.m[1][i] * b.matrix.m[c][1] +
+                            a.matrix.m[2][i] * b.matrix.m[c][2] + a.matrix.m[3][i] * b.matrix.m[c][3];
+   return r;
+}
+
+/* translations and rotations meet projections through the affine versions */
+
+constexpr Projective operator*(const Projective &a, const Translation &b)
+{
+   return a * toAffine(b);
+}
+
+constexpr Projective operator*(const Translation &a, const Projective &b)
+{
+   return toAffine(a) * b;
+}
+
+constexpr Projective operator*(const Projective &a, const Rotation &b)
+{
+   return a * toAffine(b);
+}
+
+constexpr Projective operator*(const Rotation &a, const Projective &b)
+{
+   return toAffine(a) * b;
+}
+
+/* accumulating onto a runtime matrix, in the same order as the C helpers */
+template <typename T>
+inline ESMatrix &operator*=(ESMatrix &m, const T &t)
+{
+   m = (toProjective(m) * t).matrix;
+   return m;
+}
+
+} /* namespace es */
+
+#endif /* _ESUTIL_HPP_ */
@@ -1,95 +1,218 @@
 
+/* sched_setaffinity() and the CPU_SET macros */
+#define _GNU_SOURCE
+
 #include <errno.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <alloca.h>
 #include <termios.h>
 #include <string.h>
-
-#include "bcm_host.h"
-
-#include <EGL/egl.h>
-
-#include "piglut.h"
-
-typedef struct
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+
+#include "piglut_internal.h"
+
+/* what option() returns for a bare --piglut-<name>, told apart from an
+   empty value by address */
+static const char bareOption[] = "";
+
+/* the value of --piglut-<name>=value, bareOption for a bare
+   --piglut-<name>, or else the environment variable.  NULL if neither is
+   set */
+static const char * option(int argc, char **argv, const char *name, const char *env)
 {
-   bool widthFromCmdLine;
-   bool heightFromCmdLine;
-   bool bppFromCmdLine;
-   unsigned int width;
-   unsigned int height;
-   unsigned int panelWidth;
-   unsigned int panelHeight;
-   unsigned int bpp;
+   size_t length = strlen(name);
+   int i;
 
-   /* callbacks */
-   displayCallback displayCb;
-   keyboardCallback keyboardCb;
-   initCallback initCb;
+   for (i = 1; i < argc; i++)
+   {
+      const char * arg = argv[i];
+
+      if (!arg || (strncmp(arg, "--piglut-", 9) != 0) ||
+          (strncmp(arg + 9, name, length) != 0))
+         continue;
+      if (arg[9 + length] == '=')
+         return arg + 9 + length + 1;
+      if (arg[9 + length] == '\0')
+         return bareOption;
+   }
+   return getenv(env);
+}
 
-   /* set by anything to terminate the main loop */
-   bool terminate;
+static bool numericOption(int argc, char **argv, const char *name, const char *env,
+                          long min, long max, long * value)
+{
+   const char * s = option(argc, argv, name, env);
+   char * end;
+   long v;
 
-   /* EGL */
-   EGLDisplay display;
-   EGLSurface surface;
-   EGLContext context;
+   if (!s)
+      return false;
 
-   /* dispmax stuff */
-   EGL_DISPMANX_WINDOW_T nativeWindow;
-   DISPMANX_ELEMENT_HANDLE_T dispmanElement;
-   DISPMANX_DISPLAY_HANDLE_T dispmanDisplay;
-   DISPMANX_UPDATE_HANDLE_T dispmanUpdate;
+   errno = 0;
+   v = strtol(s, &end, 10);
+   if ((*s == '\0') || (*end != '\0') || errno || (v < min) || (v > max))
+   {
+      fprintf(stderr, "piglut: ignoring %s \"%s\"\n", name, s);
+      return false;
+   }
+   *value = v;
+   return true;
+}
 
-   /* keyboard input */
-   struct termios oldTerminalConfig;
-   int peekCharacter;
+/* flags are on when given bare, or as anything but 0.  Empty, as in
+   PIGLUT_LATENCY= left blank, is off */
+static bool flagOption(int argc, char **argv, const char *name, const char *env)
+{
+   const char * s = option(argc, argv, name, env);
+   return s && ((s == bareOption) || ((*s != '\0') && (strcmp(s, "0") != 0)));
+}
 
-   /* user data */
-   void * userData;
-} piglut_t;
+static void parseOptions(piglut_t * p, int argc, char **argv)
+{
+   long value;
 
-#define MAX(a,b) \
-   ({ __typeof__ (a) _a = (a); \
-      __typeof__ (b) _b = (b); \
-      _a > _b ? _a : _b; })
+   if (numericOption(argc, argv, "width", "PIGLUT_WIDTH", 1, 8192, &value))
+   {
+      p->outputs[0].width = (unsigned int)value;
+      p->widthFromCmdLine = true;
+   }
+   if (numericOption(argc, argv, "height", "PIGLUT_HEIGHT", 1, 8192, &value))
+   {
+      p->outputs[0].height = (unsigned int)value;
+      p->heightFromCmdLine = true;
+   }
+   if (numericOption(argc, argv, "bpp", "PIGLUT_BPP", 16, 32, &value))
+   {
+      if ((value == 16) || (value == 24) || (value == 32))
+      {
+         p->outputs[0].bpp = (unsigned int)value;
+         p->bppFromCmdLine = true;
+      }
+      else
+         fprintf(stderr, "piglut: ignoring bpp \"%ld\"\n", value);
+   }
 
-#define MIN(a,b) \
-   ({ __typeof__ (a) _a = (a); \
-      __typeof__ (b) _b = (b); \
-      _a < _b ? _a : _b; })
+   /* the profile sets defaults that the individual options then override */
+   p->cpu = -1;
+   if (flagOption(argc, argv, "latency", "PIGLUT_LATENCY"))
+   {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
 
-#define MAX_WIDTH 1920
-#define MAX_HEIGHT 1080
+      /* the last core, the first is where most interrupts end up */
+      p->cpu = (cpus > 1) ? (int)(cpus - 1) : -1;
+      p->fifoPriority = LATENCY_FIFO_PRIORITY;
+      p->lockMemory = true;
+      p->prefaultKB = LATENCY_PREFAULT_KB;
+   }
+   if (numericOption(argc, argv, "cpu", "PIGLUT_CPU", -1, CPU_SETSIZE - 1, &value))
+      p->cpu = (int)value;
+   if (numericOption(argc, argv, "fifo", "PIGLUT_FIFO", 0, 99, &value))
+      p->fifoPriority = (int)value;
+   if (option(argc, argv, "mlock", "PIGLUT_MLOCK"))
+      p->lockMemory = flagOption(argc, argv, "mlock", "PIGLUT_MLOCK");
+   if (numericOption(argc, argv, "prefault", "PIGLUT_PREFAULT", 0, 65536, &value))
+      p->prefaultKB = (unsigned int)value;
+}
 
 void * piglutInit(int argc, char **argv)
 {
    piglut_t * p = (piglut_t *)malloc(sizeof(piglut_t));
    if (p)
    {
+      unsigned int i;
+
       memset(p, 0, sizeof(piglut_t));
 
-      /* TODO : command line parsing */
+      parseOptions(p, argc, argv);
+
+      for (i = 0; i < MESSAGE_QUEUE_DEPTH; i++)
+         p->messages.slots[i].sequence = i;
+
+      /* the main display (LCD) */
+      p->outputs[0].displayId = 0;
+      p->outputCount = 1;
+
+      p->resourceFree = -1;
+      p->lruHead = -1;
+      p->lruTail = -1;
+      p->exporter.fd = -1;
+
+      /* lets other threads and timers wake up the main loop */
+      p->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      p->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+      if ((p->wakeFd < 0) || (p->timerFd < 0))
+      {
+         if (p->wakeFd >= 0)
+            close(p->wakeFd);
+         if (p->timerFd >= 0)
+            close(p->timerFd);
+         free(p);
+         return NULL;
+      }
    }
 
    /* NULL on error */
    return (void *)p;
 }
 
+static void closeOutput(piglut_t * p, output_t * o)
+{
+   if (o->surface != EGL_NO_SURFACE)
+      eglDestroySurface(p->display, o->surface);
+   if (o->context != EGL_NO_CONTEXT)
+      eglDestroyContext(p->display, o->context);
+
+#ifndef PIGLUT_HEADLESS
+   if (o->dispmanElement)
+   {
+      DISPMANX_UPDATE_HANDLE_T dispmanUpdate = vc_dispmanx_update_start(0);
+      vc_dispmanx_element_remove(dispmanUpdate, o->dispmanElement);
+      vc_dispmanx_update_submit_sync(dispmanUpdate);
+   }
+   if (o->dispmanDisplay)
+      vc_dispmanx_display_close(o->dispmanDisplay);
+#endif
+}
+
 void piglutTerm(void *pg)
 {
    piglut_t * p = (piglut_t *)pg;
    if (p)
    {
-      /* TODO : find out what's required to terminate */
-      p->dispmanUpdate = vc_dispmanx_update_start(0);
-      vc_dispmanx_element_remove(p->dispmanDisplay, p->dispmanElement);
-      vc_dispmanx_update_submit_sync(p->dispmanUpdate);
+      unsigned int i;
+
+      /* while a context is still current to delete them */
+      piglutResourcesTerm(p);
+      piglutExportTerm(p);
+
+      if (p->display != EGL_NO_DISPLAY)
+         eglMakeCurrent(p->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 
-      vc_dispmanx_display_close(p->dispmanDisplay);
+      for (i = 0; i < p->outputCount; i++)
+         closeOutput(p, &p->outputs[i]);
 
+      if (p->display != EGL_NO_DISPLAY)
+         eglTerminate(p->display);
+
+      free(p->uniformCache);
+      free(p->submitScratch);
+
+#ifndef PIGLUT_HEADLESS
       bcm_host_deinit();
+#endif
+
+      close(p->wakeFd);
+      close(p->timerFd);
 
       /* makes sure that if anyone kept a reference, it's gone */
       memset(p, 0, sizeof(piglut_t));
@@ -114,32 +237,24 @@ int piglutInitWindowSize(void *pg,
                          piglutWindowConfig_t * wc)
 {
    piglut_t * p = (piglut_t *)pg;
-   unsigned int width = wc->width;
-   unsigned int height = wc->height;
-   unsigned int bpp = wc->bpp;
-   if (p)
+   if (p && wc)
    {
       /* verify the new values prior to saving them */
-      if (!p->widthFromCmdLine)
-         width = MIN(width, MAX_WIDTH);
-
-      if (!p->heightFromCmdLine)
-         height = MIN(height, MAX_HEIGHT);
-
-      if ((!p->bppFromCmdLine) && (bpp == 32))
-         p->bpp = 32;
-      else if ((!p->bppFromCmdLine) && (bpp == 24))
-         p->bpp = 24;
-      else if ((!p->bppFromCmdLine) && (bpp == 16))
-         p->bpp = 16;
-      else
+      if ((!p->bppFromCmdLine) &&
+          (wc->bpp != 32) && (wc->bpp != 24) && (wc->bpp != 16))
       {
          errno = EINVAL;
          return -1;
       }
 
-      p->width = width;
-      p->height = height;
+      if (!p->widthFromCmdLine)
+         p->outputs[0].width = MIN(wc->width, MAX_WIDTH);
+
+      if (!p->heightFromCmdLine)
+         p->outputs[0].height = MIN(wc->height, MAX_HEIGHT);
+
+      if (!p->bppFromCmdLine)
+         p->outputs[0].bpp = wc->bpp;
 
       return 0;
    }
@@ -199,6 +314,7 @@ int piglutInitFunc(void *pg,
 }
 
 static void populateConfig(EGLint *p,
+                           EGLint surfaceType,
                            unsigned int bpp,
                            unsigned int depthSize,
                            unsigned int stencilSize,
@@ -254,7 +370,7 @@ static void populateConfig(EGLint *p,
    }
 
    p[i++] = EGL_SURFACE_TYPE;
-   p[i++] = EGL_WINDOW_BIT;
+   p[i++] = surfaceType;
 
    p[i++] = EGL_RENDERABLE_TYPE;
    p[i++] = EGL_OPENGL_ES2_BIT;
@@ -262,26 +378,294 @@ static void populateConfig(EGLint *p,
    p[i++] = EGL_NONE;
 }
 
+static bool hasExtension(const char * extensions, const char * name)
+{
+   size_t length = strlen(name);
+   const char * e = extensions;
+
+   while (e && (e = strstr(e, name)) != NULL)
+   {
+      /* make sure it's not a prefix of a longer extension name */
+      if (((e == extensions) || (e[-1] == ' ')) &&
+          ((e[length] == ' ') || (e[length] == '\0')))
+         return true;
+      e += length;
+   }
+   return false;
+}
+
+static unsigned long long rectArea(const piglutRect_t * r)
+{
+   return (unsigned long long)r->width * r->height;
+}
+
+/* edges in long long, as widths of up to 0xFFFFFFFF (as in "everything")
+   would wrap in int */
+static long long rectRight(const piglutRect_t * r)
+{
+   return (long long)r->x + r->width;
+}
+
+static long long rectTop(const piglutRect_t * r)
+{
+   return (long long)r->y + r->height;
+}
+
+static piglutRect_t rectUnion(const piglutRect_t * a, const piglutRect_t * b)
+{
+   piglutRect_t r;
+   long long right = MAX(rectRight(a), rectRight(b));
+   long long top = MAX(rectTop(a), rectTop(b));
+
+   r.x = MIN(a->x, b->x);
+   r.y = MIN(a->y, b->y);
+   r.width = (unsigned int)MIN(right - r.x, 0xFFFFFFFFLL);
+   r.height = (unsigned int)MIN(top - r.y, 0xFFFFFFFFLL);
+   return r;
+}
+
+static bool rectOverlaps(const piglutRect_t * a, const piglutRect_t * b)
+{
+   return (a->x < rectRight(b)) && (b->x < rectRight(a)) &&
+          (a->y < rectTop(b)) && (b->y < rectTop(a));
+}
+
+/* clips to the surface, returns false if nothing is left */
+static bool rectClip(piglutRect_t * r, unsigned int width, unsigned int height)
+{
+   long long right = MIN(rectRight(r), (long long)width);
+   long long top = MIN(rectTop(r), (long long)height);
+
+   r->x = MAX(r->x, 0);
+   r->y = MAX(r->y, 0);
+   if ((right <= r->x) || (top <= r->y))
+      return false;
+
+   r->width = (unsigned int)(right - r->x);
+   r->height = (unsigned int)(top - r->y);
+   return true;
+}
+
+/* folds together anything that overlaps (so no pixel is drawn twice), then
+   keeps joining the pair whose union adds the fewest pixels until there are
+   no more than maxRegions left.  Returns the new count */
+static unsigned int mergeRegions(piglutRect_t * r, unsigned int n, unsigned int maxRegions)
+{
+   while (n > 1)
+   {
+      unsigned int i, j, bestI = 0, bestJ = 1;
+      long long bestCost = -1;
+      bool overlap = false;
+
+      for (i = 0; (i < n) && !overlap; i++)
+      {
+         for (j = i + 1; j < n; j++)
+         {
+            piglutRect_t u;
+            long long cost;
+
+            if (rectOverlaps(&r[i], &r[j]))
+            {
+               bestI = i;
+               bestJ = j;
+               overlap = true;
+               break;
+            }
+
+            u = rectUnion(&r[i], &r[j]);
+            cost = (long long)(rectArea(&u) - rectArea(&r[i]) - rectArea(&r[j]));
+            if ((bestCost < 0) || (cost < bestCost))
+            {
+               bestCost = cost;
+               bestI = i;
+               bestJ = j;
+            }
+         }
+      }
+
+      if (!overlap && (n <= maxRegions))
+         break;
+
+      r[bestI] = rectUnion(&r[bestI], &r[bestJ]);
+      r[bestJ] = r[--n];
+   }
+   return n;
+}
+
+static void postFullDamage(output_t * o)
+{
+   o->damage[0].x = 0;
+   o->damage[0].y = 0;
+   o->damage[0].width = o->width;
+   o->damage[0].height = o->height;
+   o->damageCount = 1;
+}
+
+static void addDamage(output_t * o, const piglutRect_t * rect)
+{
+   /* once full, grow the last entry rather than lose anything */
+   if (o->damageCount < MAX_DAMAGE_RECTS)
+      o->damage[o->damageCount++] = *rect;
+   else
+      o->damage[MAX_DAMAGE_RECTS - 1] = rectUnion(&o->damage[MAX_DAMAGE_RECTS - 1], rect);
+}
+
+static bool anyDamage(piglut_t * p)
+{
+   unsigned int i;
+
+   for (i = 0; i < p->outputCount; i++)
+   {
+      if (p->outputs[i].damageCount > 0)
+         return true;
+   }
+   return false;
+}
+
+static void setupPartialUpdate(piglut_t * p)
+{
+   const char * extensions = eglQueryString(p->display, EGL_EXTENSIONS);
+   unsigned int i;
+
+   if (hasExtension(extensions, "EGL_KHR_swap_buffers_with_damage"))
+      p->swapBuffersWithDamage = (swapBuffersWithDamageFunc)eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+   else if (hasExtension(extensions, "EGL_EXT_swap_buffers_with_damage"))
+      p->swapBuffersWithDamage = (swapBuffersWithDamageFunc)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+
+   for (i = 0; i < p->outputCount; i++)
+   {
+      output_t * o = &p->outputs[i];
+      EGLint surfaceType;
+
+      /* buffer age tells us exactly how stale the back buffer is, failing
+         that ask for the buffer to be preserved across the swap.  With
+         neither every drawn frame is a full redraw, but idle frames are
+         still skipped */
+      if (hasExtension(extensions, "EGL_EXT_buffer_age"))
+         o->bufferAgeSupported = true;
+      else if (eglGetConfigAttrib(p->display, o->config, EGL_SURFACE_TYPE, &surfaceType) &&
+               (surfaceType & EGL_SWAP_BEHAVIOR_PRESERVED_BIT) &&
+               eglSurfaceAttrib(p->display, o->surface, EGL_SWAP_BEHAVIOR, EGL_BUFFER_PRESERVED))
+         o->bufferPreserved = true;
+
+      /* the first frame always has to cover everything */
+      postFullDamage(o);
+   }
+}
+
+/* expects the output to be current */
+static void displayPartial(piglut_t * p, output_t * o)
+{
+   piglutRect_t current[MAX_DAMAGE_RECTS];
+   piglutRect_t regions[MAX_DAMAGE_REGIONS * (DAMAGE_HISTORY + 1)];
+   unsigned int nCurrent = 0, nRegions, i, f;
+   EGLint age = 0;
+
+   for (i = 0; i < o->damageCount; i++)
+   {
+      current[nCurrent] = o->damage[i];
+      if (rectClip(&current[nCurrent], o->width, o->height))
+         nCurrent++;
+   }
+   o->damageCount = 0;
+
+   /* nothing changed (or only off screen), so leave the front buffer up */
+   if (nCurrent == 0)
+   {
+      p->stats.framesSkipped++;
+      return;
+   }
+
+   nCurrent = mergeRegions(current, nCurrent, MAX_DAMAGE_REGIONS);
+
+   if (o->bufferAgeSupported)
+      eglQuerySurface(p->display, o->surface, EGL_BUFFER_AGE_EXT, &age);
+   else if (o->bufferPreserved)
+      age = 1;
+
+   if ((age > 0) && (age <= DAMAGE_HISTORY + 1))
+   {
+      /* the back buffer is also missing whatever changed in the frames
+         presented since it was last on screen */
+      memcpy(regions, current, nCurrent * sizeof(piglutRect_t));
+      nRegions = nCurrent;
+      for (f = 1; f < (unsigned int)age; f++)
+      {
+         unsigned int h = (o->damageHistoryHead + DAMAGE_HISTORY - f) % DAMAGE_HISTORY;
+         memcpy(&regions[nRegions], o->damageHistory[h],
+                o->damageHistoryCount[h] * sizeof(piglutRect_t));
+         nRegions += o->damageHistoryCount[h];
+      }
+      nRegions = mergeRegions(regions, nRegions, MAX_DAMAGE_REGIONS);
+   }
+   else
+   {
+      /* undefined contents */
+      regions[0].x = 0;
+      regions[0].y = 0;
+      regions[0].width = o->width;
+      regions[0].height = o->height;
+      nRegions = 1;
+   }
+
+   /* displayCb may have changed the scissor with raw GL calls, which the
+      cache can't see, so each region's is always set */
+   for (i = 0; i < nRegions; i++)
+   {
+      piglutGLStateForgetScissor(p->glState);
+      piglutGLStateEnable(p, GL_SCISSOR_TEST, true);
+      piglutGLStateScissor(p, regions[i].x, regions[i].y, regions[i].width, regions[i].height);
+      p->displayCb(p);
+      p->stats.pixelsDrawn += rectArea(&regions[i]);
+   }
+   piglutGLStateForgetScissor(p->glState);
+   piglutGLStateEnable(p, GL_SCISSOR_TEST, false);
+
+   /* the back buffer is whole again, the damaged parts drawn over the rest */
+   piglutExportCapture(p, p->currentOutput);
+
+   if (p->swapBuffersWithDamage)
+   {
+      EGLint rects[MAX_DAMAGE_REGIONS * 4];
+      for (i = 0; i < nCurrent; i++)
+      {
+         rects[(i * 4) + 0] = current[i].x;
+         rects[(i * 4) + 1] = current[i].y;
+         rects[(i * 4) + 2] = current[i].width;
+         rects[(i * 4) + 3] = current[i].height;
+      }
+      p->swapBuffersWithDamage(p->display, o->surface, rects, nCurrent);
+   }
+   else
+      eglSwapBuffers(p->display, o->surface);
+
+   memcpy(o->damageHistory[o->damageHistoryHead], current, nCurrent * sizeof(piglutRect_t));
+   o->damageHistoryCount[o->damageHistoryHead] = nCurrent;
+   o->damageHistoryHead = (o->damageHistoryHead + 1) % DAMAGE_HISTORY;
+
+   p->stats.framesDrawn++;
+}
+
 static int kbhit(piglut_t * p)
 {
    unsigned char ch;
-   int nRead;
-   struct termios term;
+   struct pollfd fd;
 
    /* character pending */
    if (p->peekCharacter != -1)
       return 1;
 
-   tcgetattr(STDIN_FILENO, &term);
-   term.c_cc[VMIN] = 0;
-   tcsetattr(STDIN_FILENO, TCSANOW, &term);
-   nRead = read(STDIN_FILENO, &ch, 1);
-   term.c_cc[VMIN] = 1;
-   tcsetattr(STDIN_FILENO, TCSANOW, &term);
-   if (nRead == 1)
+   fd.fd = STDIN_FILENO;
+   fd.events = POLLIN;
+   if (!p->keyboardClosed && (poll(&fd, 1, 0) == 1))
    {
-      p->peekCharacter = ch;
-      return 1;
+      if (read(STDIN_FILENO, &ch, 1) == 1)
+      {
+         p->peekCharacter = ch;
+         return 1;
+      }
+      /* end of file or error, so stop watching it */
+      p->keyboardClosed = true;
    }
    return 0;
 }
@@ -303,154 +687,425 @@ static int readch(piglut_t * p)
    return ch;
 }
 
+static bool timespecBefore(const struct timespec * a, const struct timespec * b)
+{
+   return (a->tv_sec < b->tv_sec) ||
+          ((a->tv_sec == b->tv_sec) && (a->tv_nsec < b->tv_nsec));
+}
 
-int piglutMainLoop(void *pg)
+/* arms the timerfd for the earliest deadline, or disarms it */
+static void armTimer(piglut_t * p)
 {
-   piglut_t * p = (piglut_t *)pg;
-   if (p)
+   struct itimerspec spec;
+   unsigned int i;
+
+   memset(&spec, 0, sizeof(spec));
+   for (i = 0; i < p->timerCount; i++)
    {
-      VC_RECT_T dstRect;
-      VC_RECT_T srcRect;
-      VC_DISPMANX_ALPHA_T layerAlpha;
-      EGLint configAttributes[32];
-      EGLint numberConfigs, selectedConfig;
-      EGLConfig * eglConfigs;
-      int i;
-      struct termios newTerminalConfig;
+      if ((i == 0) || timespecBefore(&p->timers[i].deadline, &spec.it_value))
+         spec.it_value = p->timers[i].deadline;
+   }
+   timerfd_settime(p->timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
 
-      static const EGLint contextAttributes[] =
-      {
-         EGL_CONTEXT_CLIENT_VERSION, 2,
-         EGL_NONE
-      };
+static void runTimers(piglut_t * p)
+{
+   pendingTimer_t expired[MAX_TIMERS];
+   unsigned int nExpired = 0, i = 0;
+   struct timespec now;
 
-      bcm_host_init();
+   clock_gettime(CLOCK_MONOTONIC, &now);
 
-      /* setup dispmax */
-      if (graphics_get_display_size(0 /* LCD */, &p->panelWidth, &p->panelHeight))
-      {
-         errno = ECONNREFUSED;
-         return -1;
-      }
-      /* reclamp the state width and height to that of the display */
-      p->width = MIN(p->width, p->panelWidth);
-      p->height = MIN(p->height, p->panelHeight);
-
-      dstRect.x = 0;
-      dstRect.y = 0;
-      dstRect.width = p->panelWidth;
-      dstRect.height = p->panelHeight;
-
-      srcRect.x = 0;
-      srcRect.y = 0;
-      srcRect.width = p->width << 16;
-      srcRect.height = p->height << 16;
-
-      /* this is nothing to do with the EGL window having alpha, but how its
-         blended to the console underneath */
-      layerAlpha.flags = DISPMANX_FLAGS_ALPHA_FIXED_ALL_PIXELS;
-      layerAlpha.opacity = 255;
-      layerAlpha.mask = 0;
-
-      p->dispmanDisplay = vc_dispmanx_display_open(0 /* LCD */);
-
-      /* this pairs with the vc_dispmanx_update_submit_sync() below,
-         which applies the changes inbetween */
-      p->dispmanUpdate = vc_dispmanx_update_start(0);
-
-      p->dispmanElement = vc_dispmanx_element_add(p->dispmanUpdate,
-                                                  p->dispmanDisplay,
-                                                  0/*layer*/,
-                                                  &dstRect,
-                                                  0/*src*/,
-                                                  &srcRect,
-                                                  DISPMANX_PROTECTION_NONE,
-                                                  &layerAlpha,
-                                                  0/*clamp*/,
-                                                  0/*transform*/);
-
-      p->nativeWindow.element = p->dispmanElement;
-      p->nativeWindow.width = p->width;
-      p->nativeWindow.height = p->height;
-
-      vc_dispmanx_update_submit_sync(p->dispmanUpdate);
-
-      /* TODO : Add cleanup if failure */
-
-      /* create an EGL context */
-      p->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-      if (p->display == EGL_NO_DISPLAY)
+   /* take them all off the list first, a callback may well add a new one */
+   while (i < p->timerCount)
+   {
+      if (timespecBefore(&now, &p->timers[i].deadline))
+         i++;
+      else
       {
-         errno = ECONNREFUSED;
-         return -1;
+         expired[nExpired++] = p->timers[i];
+         p->timers[i] = p->timers[--p->timerCount];
       }
+   }
 
-      /* initialize the EGL display connection */
-      if (eglInitialize(p->display, NULL, NULL) == EGL_FALSE)
-      {
-         errno = ECONNREFUSED;
-         return -1;
-      }
+   for (i = 0; i < nExpired; i++)
+      expired[i].timer(p, expired[i].value);
+
+   armTimer(p);
+}
 
-      /* TODO : add depth stencil config to the API */
-      populateConfig(configAttributes, p->bpp, 15, 1, false);
+static void wake(piglut_t * p)
+{
+   uint64_t one = 1;
+
+   /* only the first waker since the loop last woke up pays for the write */
+   if (__atomic_exchange_n(&p->wakePending, 1, __ATOMIC_SEQ_CST) == 0)
+      write(p->wakeFd, &one, sizeof(one));
+}
+
+static void drainMessages(piglut_t * p)
+{
+   messageQueue_t * q = &p->messages;
+   unsigned int n;
+
+   /* bounded so a busy producer can't starve the display */
+   for (n = 0; n < MESSAGE_QUEUE_DEPTH; n++)
+   {
+      unsigned int pos = q->dequeuePos;
+      messageSlot_t * slot = &q->slots[pos & (MESSAGE_QUEUE_DEPTH - 1)];
+
+      /* not yet published */
+      if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1)
+         break;
 
-      if (!eglGetConfigs(p->display, NULL, 0, &numberConfigs))
+      if (p->messageCb)
       {
-         errno = ECONNREFUSED;
-         return -1;
+         p->messageCb(p, slot->type, slot->data, slot->size);
+         p->stats.messagesDelivered++;
       }
 
-      eglConfigs = (EGLConfig *)alloca(numberConfigs * sizeof(EGLConfig));
+      /* hand the slot back to the producers for the next lap */
+      __atomic_store_n(&slot->sequence, pos + MESSAGE_QUEUE_DEPTH, __ATOMIC_RELEASE);
+      q->dequeuePos = pos + 1;
+   }
+}
+
+/* handles input, timers and wakeups, blocking until one of them arrives
+   if asked to */
+static void waitForEvents(piglut_t * p, bool block)
+{
+   struct pollfd fds[3];
+   nfds_t nfds = 2;
+   uint64_t count;
+
+   fds[0].fd = p->wakeFd;
+   fds[0].events = POLLIN;
+   fds[1].fd = p->timerFd;
+   fds[1].events = POLLIN;
+   if (p->keyboardCb && !p->keyboardClosed)
+   {
+      fds[2].fd = STDIN_FILENO;
+      fds[2].events = POLLIN;
+      nfds++;
+   }
+
+   if (poll(fds, nfds, block ? -1 : 0) <= 0)
+      return;
+
+   if (fds[0].revents & POLLIN)
+   {
+      read(p->wakeFd, &count, sizeof(count));
+      __atomic_store_n(&p->wakePending, 0, __ATOMIC_SEQ_CST);
+   }
+
+   if (fds[1].revents & POLLIN)
+   {
+      read(p->timerFd, &count, sizeof(count));
+      runTimers(p);
+   }
+
+   if ((nfds > 2) && fds[2].revents)
+   {
+      /* returning true from the keyboard function will quit */
+      while (!p->terminate && kbhit(p))
+         p->terminate = p->keyboardCb(p, readch(p));
+   }
+}
+
+static EGLDisplay getDisplay(void)
+{
+#ifdef PIGLUT_HEADLESS
+   /* there's no window system to rely on, so use Mesa's surfaceless
+      platform where it's available */
+   const char * clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+   if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+   {
+      getPlatformDisplayFunc getPlatformDisplay =
+         (getPlatformDisplayFunc)eglGetProcAddress("eglGetPlatformDisplayEXT");
+      if (getPlatformDisplay)
+         return getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+   }
+#endif
+   return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool piglutChooseConfig(piglut_t * p, unsigned int bpp, EGLConfig * config)
+{
+   EGLint configAttributes[32];
+   EGLint numberConfigs;
+   EGLConfig * eglConfigs;
+   int i;
+
+   /* TODO : add depth stencil config to the API */
+   populateConfig(configAttributes, OUTPUT_SURFACE_TYPE, bpp, 15, 1, false);
+
+   if (!eglGetConfigs(p->display, NULL, 0, &numberConfigs))
+      return false;
+
+   eglConfigs = (EGLConfig *)alloca(numberConfigs * sizeof(EGLConfig));
+
+   if (!eglChooseConfig(p->display, configAttributes, eglConfigs, numberConfigs, &numberConfigs) || (numberConfigs == 0))
+      return false;
+
+   for (i = 0; i < numberConfigs; i++)
+   {
+      EGLint redSize, greenSize, blueSize, alphaSize, depthSize;
+      eglGetConfigAttrib(p->display, eglConfigs[i], EGL_RED_SIZE, &redSize);
+      eglGetConfigAttrib(p->display, eglConfigs[i], EGL_GREEN_SIZE, &greenSize);
+      eglGetConfigAttrib(p->display, eglConfigs[i], EGL_BLUE_SIZE, &blueSize);
+      eglGetConfigAttrib(p->display, eglConfigs[i], EGL_ALPHA_SIZE, &alphaSize);
+      eglGetConfigAttrib(p->display, eglConfigs[i], EGL_DEPTH_SIZE, &depthSize);
+
+      if (bpp == (redSize + greenSize + blueSize + alphaSize))
+         break;
+   }
+
+   /* nothing matched exactly, so go with EGL's first preference */
+   if (i == numberConfigs)
+      i = 0;
+
+   *config = eglConfigs[i];
+   return true;
+}
+
+/* creates the surface and a context sharing objects with shareContext */
+static int openOutput(piglut_t * p, output_t * o, EGLContext shareContext)
+{
+#ifdef PIGLUT_HEADLESS
+   EGLint surfaceAttributes[5];
+#else
+   VC_RECT_T dstRect;
+   VC_RECT_T srcRect;
+   VC_DISPMANX_ALPHA_T layerAlpha;
+   DISPMANX_UPDATE_HANDLE_T dispmanUpdate;
+#endif
+
+   static const EGLint contextAttributes[] =
+   {
+      EGL_CONTEXT_CLIENT_VERSION, 2,
+      EGL_NONE
+   };
+
+#ifdef PIGLUT_HEADLESS
+   /* offscreen, so the panel is whatever size was asked for */
+   o->panelWidth = o->width;
+   o->panelHeight = o->height;
+#else
+   /* setup dispmax */
+   if (graphics_get_display_size(o->displayId, &o->panelWidth, &o->panelHeight))
+      return -1;
+
+   /* reclamp the state width and height to that of the display */
+   o->width = MIN(o->width, o->panelWidth);
+   o->height = MIN(o->height, o->panelHeight);
+
+   dstRect.x = 0;
+   dstRect.y = 0;
+   dstRect.width = o->panelWidth;
+   dstRect.height = o->panelHeight;
+
+   srcRect.x = 0;
+   srcRect.y = 0;
+   srcRect.width = o->width << 16;
+   srcRect.height = o->height << 16;
+
+   /* this is nothing to do with the EGL window having alpha, but how its
+      blended to the console underneath */
+   layerAlpha.flags = DISPMANX_FLAGS_ALPHA_FIXED_ALL_PIXELS;
+   layerAlpha.opacity = 255;
+   layerAlpha.mask = 0;
+
+   o->dispmanDisplay = vc_dispmanx_display_open(o->displayId);
+
+   /* this pairs with the vc_dispmanx_update_submit_sync() below,
+      which applies the changes inbetween */
+   dispmanUpdate = vc_dispmanx_update_start(0);
+
+   o->dispmanElement = vc_dispmanx_element_add(dispmanUpdate,
+                                               o->dispmanDisplay,
+                                               0/*layer*/,
+                                               &dstRect,
+                                               0/*src*/,
+                                               &srcRect,
+                                               DISPMANX_PROTECTION_NONE,
+                                               &layerAlpha,
+                                               0/*clamp*/,
+                                               0/*transform*/);
+
+   o->nativeWindow.element = o->dispmanElement;
+   o->nativeWindow.width = o->width;
+   o->nativeWindow.height = o->height;
+
+   vc_dispmanx_update_submit_sync(dispmanUpdate);
+#endif
+
+   if (!piglutChooseConfig(p, o->bpp, &o->config))
+      return -1;
+
+   /* create an EGL rendering context */
+   o->context = eglCreateContext(p->display, o->config, shareContext, contextAttributes);
+   if (o->context == EGL_NO_CONTEXT)
+      return -1;
+
+   /* a new context, so nothing it holds is known yet */
+   piglutGLStateReset(&o->glState);
+
+#ifdef PIGLUT_HEADLESS
+   surfaceAttributes[0] = EGL_WIDTH;
+   surfaceAttributes[1] = o->width;
+   surfaceAttributes[2] = EGL_HEIGHT;
+   surfaceAttributes[3] = o->height;
+   surfaceAttributes[4] = EGL_NONE;
+   o->surface = eglCreatePbufferSurface(p->display, o->config, surfaceAttributes);
+#else
+   o->surface = eglCreateWindowSurface(p->display, o->config, &o->nativeWindow, NULL);
+#endif
+   if (o->surface == EGL_NO_SURFACE)
+      return -1;
+
+   return 0;
+}
+
+/* touches the stack below the caller so the main loop's page faults happen
+   now rather than mid frame.  Out of line so the space really is below */
+static __attribute__((noinline)) void prefaultStack(size_t bytes)
+{
+   volatile unsigned char * stack = (volatile unsigned char *)alloca(bytes);
+   size_t page = (size_t)sysconf(_SC_PAGESIZE);
+   size_t i;
 
-      if (!eglChooseConfig(p->display, configAttributes, eglConfigs, numberConfigs, &numberConfigs) || (numberConfigs == 0))
+   for (i = 0; i < bytes; i += page)
+      stack[i] = 0;
+}
+
+static void latencyFailed(const char *what)
+{
+   fprintf(stderr, "piglut: couldn't %s: %s\n", what, strerror(errno));
+}
+
+/* on the calling thread, which runs the main loop.  Whatever can't be done
+   is reported and left out of stats.latencyApplied */
+static void applyLatencyProfile(piglut_t * p)
+{
+   if (p->cpu >= 0)
+   {
+      cpu_set_t cpus;
+
+      CPU_ZERO(&cpus);
+      CPU_SET(p->cpu, &cpus);
+      p->stats.latencyRequested |= PIGLUT_LATENCY_AFFINITY;
+      if (sched_setaffinity(0, sizeof(cpus), &cpus) == 0)
+         p->stats.latencyApplied |= PIGLUT_LATENCY_AFFINITY;
+      else
+         latencyFailed("pin the main loop to its cpu");
+   }
+
+   if (p->fifoPriority > 0)
+   {
+      struct sched_param param;
+
+      memset(&param, 0, sizeof(param));
+      param.sched_priority = p->fifoPriority;
+      p->stats.latencyRequested |= PIGLUT_LATENCY_FIFO;
+      if (sched_setscheduler(0, SCHED_FIFO, &param) == 0)
+         p->stats.latencyApplied |= PIGLUT_LATENCY_FIFO;
+      else
+         latencyFailed("use SCHED_FIFO");
+   }
+
+   /* before mlockall() so the prefaulted pages get locked too */
+   if (p->prefaultKB)
+   {
+      size_t bytes = (size_t)p->prefaultKB * 1024;
+      struct rlimit limit;
+
+      p->stats.latencyRequested |= PIGLUT_LATENCY_PREFAULT;
+      /* leave room for what's already on the stack */
+      if ((getrlimit(RLIMIT_STACK, &limit) == 0) &&
+          ((limit.rlim_cur == RLIM_INFINITY) || (bytes + STACK_MARGIN <= limit.rlim_cur)))
       {
-         errno = ECONNREFUSED;
-         return -1;
+         prefaultStack(bytes);
+         p->stats.latencyApplied |= PIGLUT_LATENCY_PREFAULT;
       }
-
-      for (i = 0; i < numberConfigs; i++)
+      else
       {
-         EGLint redSize, greenSize, blueSize, alphaSize, depthSize;
-         eglGetConfigAttrib(p->display, eglConfigs[i], EGL_RED_SIZE, &redSize);
-         eglGetConfigAttrib(p->display, eglConfigs[i], EGL_GREEN_SIZE, &greenSize);
-         eglGetConfigAttrib(p->display, eglConfigs[i], EGL_BLUE_SIZE, &blueSize);
-         eglGetConfigAttrib(p->display, eglConfigs[i], EGL_ALPHA_SIZE, &alphaSize);
-         eglGetConfigAttrib(p->display, eglConfigs[i], EGL_DEPTH_SIZE, &depthSize);
-
-         if (p->bpp == (redSize + greenSize + blueSize + alphaSize))
-            break;
+         errno = E2BIG;
+         latencyFailed("prefault the stack");
       }
-      selectedConfig = i;
+   }
 
-      /* get an appropriate EGL frame buffer configuration */
-      if (eglBindAPI(EGL_OPENGL_ES_API) == EGL_FALSE)
+   if (p->lockMemory)
+   {
+      p->stats.latencyRequested |= PIGLUT_LATENCY_MLOCK;
+      if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+         p->stats.latencyApplied |= PIGLUT_LATENCY_MLOCK;
+      else
+         latencyFailed("lock memory");
+   }
+}
+
+int piglutMainLoop(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+   {
+      unsigned int i;
+      struct termios newTerminalConfig;
+
+#ifndef PIGLUT_HEADLESS
+      bcm_host_init();
+#endif
+
+      /* create an EGL display */
+      p->display = getDisplay();
+      if (p->display == EGL_NO_DISPLAY)
       {
          errno = ECONNREFUSED;
          return -1;
       }
 
-      /* create an EGL rendering context */
-      p->context = eglCreateContext(p->display, eglConfigs[selectedConfig], EGL_NO_CONTEXT, contextAttributes);
-      if (p->context == EGL_NO_CONTEXT)
+      /* initialize the EGL display connection */
+      if (eglInitialize(p->display, NULL, NULL) == EGL_FALSE)
       {
          errno = ECONNREFUSED;
          return -1;
       }
 
-      p->surface = eglCreateWindowSurface(p->display, eglConfigs[selectedConfig], &p->nativeWindow, NULL);
-      if (p->surface == EGL_NO_SURFACE)
+      if (eglBindAPI(EGL_OPENGL_ES_API) == EGL_FALSE)
       {
          errno = ECONNREFUSED;
          return -1;
       }
 
+      /* every context shares with the first, so textures and buffers only
+         get uploaded once.  Anything opened is cleaned up by piglutTerm() */
+      for (i = 0; i < p->outputCount; i++)
+      {
+         if (openOutput(p, &p->outputs[i], (i == 0) ? EGL_NO_CONTEXT : p->outputs[0].context))
+         {
+            errno = ECONNREFUSED;
+            return -1;
+         }
+      }
+
       /* connect the context to the surface */
-      if (eglMakeCurrent(p->display, p->surface, p->surface, p->context) == EGL_FALSE)
+      if (eglMakeCurrent(p->display, p->outputs[0].surface, p->outputs[0].surface, p->outputs[0].context) == EGL_FALSE)
       {
          errno = ECONNREFUSED;
          return -1;
       }
+      p->currentOutput = 0;
+      p->glState = &p->outputs[0].glState;
+
+      if (p->partialUpdate)
+         setupPartialUpdate(p);
+
+      /* the exported output's size is settled now */
+      piglutExportSetup(p);
+
+      /* an initial frame, even when event driven, so the surface isn't
+         left undefined until the first input or timer */
+      __atomic_store_n(&p->redisplayPending, 1, __ATOMIC_SEQ_CST);
 
       /* this is called when GL is up, so suits texture loading, one time init, etc */
       if (p->initCb)
@@ -467,21 +1122,75 @@ int piglutMainLoop(void *pg)
       newTerminalConfig.c_cc[VTIME] = 0;
       tcsetattr(STDIN_FILENO, TCSANOW, &newTerminalConfig);
 
+      /* last, so the threads the driver started during set up keep the
+         default policy */
+      applyLatencyProfile(p);
+
       while (!p->terminate)
       {
-         if (p->keyboardCb)
+         bool redisplay;
+         /* with partial updates an idle frame doesn't swap, so there is no
+            vsync to hold the loop back and it has to sleep instead */
+         bool onDemand = p->eventDriven || p->partialUpdate;
+         unsigned long long glIssued, glSkipped;
+
+         /* otherwise this just picks up whatever is waiting */
+         waitForEvents(p, onDemand &&
+                          !__atomic_load_n(&p->redisplayPending, __ATOMIC_SEQ_CST) &&
+                          !anyDamage(p));
+         if (p->terminate)
+            break;
+
+         drainMessages(p);
+
+         redisplay = __atomic_exchange_n(&p->redisplayPending, 0, __ATOMIC_SEQ_CST);
+
+         if (!p->displayCb || (onDemand && !redisplay && !anyDamage(p)))
+            continue;
+
+         p->frameNumber++;
+         glIssued = p->stats.glCallsIssued;
+         glSkipped = p->stats.glCallsSkipped;
+
+         /* outputs are drawn in turn on this thread */
+         for (i = 0; i < p->outputCount; i++)
          {
-            if (kbhit(p))
+            output_t * o = &p->outputs[i];
+
+            if (p->partialUpdate)
             {
-               do
+               if (redisplay)
+                  postFullDamage(o);
+               else if (o->damageCount == 0)
                {
-                  /* returning true from the keyboard function will quit */
-                  p->terminate = p->keyboardCb(pg, readch(p));
-               } while (kbhit(p));
+                  p->stats.framesSkipped++;
+                  continue;
+               }
+            }
+
+            if (p->outputCount > 1)
+            {
+               eglMakeCurrent(p->display, o->surface, o->surface, o->context);
+               p->glState = &o->glState;
+            }
+            p->currentOutput = i;
+            p->exporter.captured = false;
+
+            if (p->partialUpdate)
+               displayPartial(p, o);
+            else
+            {
+               p->displayCb(pg);
+               piglutExportAfterDisplay(p, i);
+               o->damageCount = 0;
+               p->stats.framesDrawn++;
+               p->stats.pixelsDrawn += (unsigned long long)o->width * o->height;
             }
          }
-         if (p->displayCb)
-            p->displayCb(pg);
+         p->currentOutput = 0;
+
+         p->stats.frameGLCallsIssued = (unsigned int)(p->stats.glCallsIssued - glIssued);
+         p->stats.frameGLCallsSkipped = (unsigned int)(p->stats.glCallsSkipped - glSkipped);
       }
 
       /* return the keyboard to default handler state */
@@ -529,10 +1238,12 @@ int piglutGetDisplayConfig(void *pg,
    piglut_t * p = (piglut_t *)pg;
    if (p && dc)
    {
-      dc->width = p->width;
-      dc->height = p->height;
-      dc->panelWidth = p->panelWidth;
-      dc->panelHeight = p->panelHeight;
+      output_t * o = &p->outputs[p->currentOutput];
+
+      dc->width = o->width;
+      dc->height = o->height;
+      dc->panelWidth = o->panelWidth;
+      dc->panelHeight = o->panelHeight;
 
       return 0;
    }
@@ -543,3 +1254,266 @@ int piglutGetDisplayConfig(void *pg,
    }
 }
 
+int piglutSetPartialUpdate(void *pg, bool enable)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+   {
+      p->partialUpdate = enable;
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutPostDamage(void *pg, const piglutRect_t * rect)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p && rect)
+   {
+      unsigned int i;
+
+      if ((rect->width == 0) || (rect->height == 0))
+         return 0;
+
+      for (i = 0; i < p->outputCount; i++)
+         addDamage(&p->outputs[i], rect);
+
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutGetStats(void *pg, piglutStats_t * stats)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p && stats)
+   {
+      *stats = p->stats;
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutSetEventDriven(void *pg, bool enable)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+   {
+      p->eventDriven = enable;
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutPostRedisplay(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+   {
+      __atomic_store_n(&p->redisplayPending, 1, __ATOMIC_SEQ_CST);
+      wake(p);
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutTimerFunc(void *pg, unsigned int msecs,
+                    timerCallback timer, int value)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p && timer)
+   {
+      pendingTimer_t * t;
+
+      if (p->timerCount == MAX_TIMERS)
+      {
+         errno = ENOSPC;
+         return -1;
+      }
+
+      t = &p->timers[p->timerCount++];
+      clock_gettime(CLOCK_MONOTONIC, &t->deadline);
+      t->deadline.tv_sec += msecs / 1000;
+      t->deadline.tv_nsec += (long)(msecs % 1000) * 1000000L;
+      if (t->deadline.tv_nsec >= 1000000000L)
+      {
+         t->deadline.tv_sec++;
+         t->deadline.tv_nsec -= 1000000000L;
+      }
+      t->timer = timer;
+      t->value = value;
+
+      armTimer(p);
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutMessageFunc(void *pg,
+                      messageCallback message)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+   {
+      p->messageCb = message;
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutSendMessage(void *pg, int type, const void *data, unsigned int size)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p && (size <= PIGLUT_MESSAGE_SIZE) && (data || (size == 0)))
+   {
+      messageQueue_t * q = &p->messages;
+      unsigned int pos = __atomic_load_n(&q->enqueuePos, __ATOMIC_RELAXED);
+      messageSlot_t * slot;
+
+      for (;;)
+      {
+         int diff;
+
+         slot = &q->slots[pos & (MESSAGE_QUEUE_DEPTH - 1)];
+         diff = (int)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+         if (diff == 0)
+         {
+            /* slot is free, try to claim it (pos is reloaded on failure) */
+            if (__atomic_compare_exchange_n(&q->enqueuePos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+               break;
+         }
+         else if (diff < 0)
+         {
+            /* the main loop hasn't consumed this slot from the last lap */
+            __atomic_fetch_add(&p->stats.messagesDropped, 1, __ATOMIC_RELAXED);
+            errno = EAGAIN;
+            return -1;
+         }
+         else
+            pos = __atomic_load_n(&q->enqueuePos, __ATOMIC_RELAXED);
+      }
+
+      slot->type = type;
+      slot->size = size;
+      if (size)
+         memcpy(slot->data, data, size);
+      __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+
+      wake(p);
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutAddOutput(void *pg, unsigned int displayId,
+                    piglutWindowConfig_t * wc)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p && wc && ((wc->bpp == 32) || (wc->bpp == 24) || (wc->bpp == 16)))
+   {
+      output_t * o;
+
+      /* outputs are all opened when the main loop starts */
+      if (p->display != EGL_NO_DISPLAY)
+      {
+         errno = EBUSY;
+         return -1;
+      }
+
+      if (p->outputCount == MAX_OUTPUTS)
+      {
+         errno = ENOSPC;
+         return -1;
+      }
+
+      o = &p->outputs[p->outputCount];
+      o->displayId = displayId;
+      o->width = MIN(wc->width, MAX_WIDTH);
+      o->height = MIN(wc->height, MAX_HEIGHT);
+      o->bpp = wc->bpp;
+
+      return p->outputCount++;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutGetCurrentOutput(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+      return p->currentOutput;
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutPostOutputDamage(void *pg, int output, const piglutRect_t * rect)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p && rect && (output >= 0) && (output < (int)p->outputCount))
+   {
+      if ((rect->width > 0) && (rect->height > 0))
+         addDamage(&p->outputs[output], rect);
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutLeaveMainLoop(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+   {
+      __atomic_store_n(&p->terminate, true, __ATOMIC_SEQ_CST);
+      wake(p);
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
@@ -7,6 +7,17 @@ extern "C" {
 typedef void (*displayCallback)(void *pg);
 typedef bool (*keyboardCallback)(void *pg, char key);
 typedef void (*initCallback)(void *pg);
+typedef void (*timerCallback)(void *pg, int value);
+typedef void (*messageCallback)(void *pg, int type, const void *data, unsigned int size);
+
+/* parts of the latency profile, see piglutInit() */
+#define PIGLUT_LATENCY_AFFINITY 0x1
+#define PIGLUT_LATENCY_FIFO     0x2
+#define PIGLUT_LATENCY_MLOCK    0x4
+#define PIGLUT_LATENCY_PREFAULT 0x8
+
+/* largest payload piglutSendMessage() will copy */
+#define PIGLUT_MESSAGE_SIZE 64
 
 typedef struct
 {
@@ -23,6 +34,69 @@ typedef struct
    unsigned int bpp;
 } piglutWindowConfig_t;
 
+/* rectangles are in window coordinates with the origin at the bottom left,
+   the same as glScissor() */
+typedef struct
+{
+   int x;
+   int y;
+   unsigned int width;
+   unsigned int height;
+} piglutRect_t;
+
+typedef struct
+{
+   unsigned long long framesDrawn;
+   /* with partial updates, outputs left alone on a frame that drew another
+      or whose damage was all off screen */
+   unsigned long long framesSkipped;
+   /* pixel area covered by the scissor regions handed to displayCb */
+   unsigned long long pixelsDrawn;
+   unsigned long long messagesDelivered;
+   /* sends that failed because the queue was full */
+   unsigned long long messagesDropped;
+   /* calls made through the piglutgl.h wrappers that reached GL, and those
+      dropped as redundant, in total and for the most recent frame */
+   unsigned long long glCallsIssued;
+   unsigned long long glCallsSkipped;
+   unsigned int frameGLCallsIssued;
+   unsigned int frameGLCallsSkipped;
+   /* resources created through piglutres.h and their estimated size */
+   unsigned int resourcesLive;
+   unsigned int resourcesResident;
+   unsigned long long gpuBytesResident;
+   unsigned long long gpuBytesPeak;
+   unsigned long long resourceEvictions;
+   unsigned long long resourceReloads;
+   /* PIGLUT_LATENCY_ bits asked for, and those that took effect */
+   unsigned int latencyRequested;
+   unsigned int latencyApplied;
+   /* frames published by piglutExportFrames() */
+   unsigned long long framesExported;
+} piglutStats_t;
+
+/* Options are read from argv, which is left untouched, or else from the
+   environment:
+
+     --piglut-width=N         PIGLUT_WIDTH     output 0 size and depth, these
+     --piglut-height=N        PIGLUT_HEIGHT    win over piglutInitWindowSize()
+     --piglut-bpp=16|24|32    PIGLUT_BPP
+
+     --piglut-latency         PIGLUT_LATENCY=1 all of the below: the last core,
+                                               priority 50, mlock, 256KB
+     --piglut-cpu=N           PIGLUT_CPU       pin the main loop to core N,
+                                               -1 for no pinning
+     --piglut-fifo=PRIORITY   PIGLUT_FIFO      run it SCHED_FIFO (1 to 99)
+     --piglut-mlock           PIGLUT_MLOCK=1   mlockall() current and future
+     --piglut-prefault=KB     PIGLUT_PREFAULT  fault in that much stack
+
+   The individual options override --piglut-latency.  -1 turns the pinning
+   off, as 0 is a core (usually the one taking interrupts), and 0 turns off
+   each of the others.  Flags left empty are off.  The profile is applied
+   to the thread calling piglutMainLoop() once set up is done.  Anything
+   that fails, usually for want of privileges (CAP_SYS_NICE,
+   RLIMIT_MEMLOCK), is reported on stderr and is missing from
+   latencyApplied in piglutGetStats() */
 void * piglutInit(int argc, char **argv);
 
 void piglutTerm(void *pg);
@@ -33,9 +107,23 @@ void piglutInitWindowConfig(piglutWindowConfig_t * wc);
 int piglutInitWindowSize(void *pg,
                          piglutWindowConfig_t * wc);
 
+/* reports the output being drawn when called from displayCb, otherwise
+   output 0 */
 int piglutGetDisplayConfig(void *pg,
                            piglutDisplayConfig_t * dc);
 
+/* drives another display from the same process (displayId is the dispmanx
+   display, e.g. 2 for HDMI, ignored when headless where each output is an
+   offscreen surface).  Must be called before piglutMainLoop(); output 0 is
+   the one set up by piglutInitWindowSize().  Each output gets its own surface
+   and a context sharing objects with output 0, and displayCb is called once
+   per output with that output current.  Returns the new output's number */
+int piglutAddOutput(void *pg, unsigned int displayId,
+                    piglutWindowConfig_t * wc);
+
+/* the output displayCb is drawing, 0 outside of it */
+int piglutGetCurrentOutput(void *pg);
+
 int piglutDisplayFunc(void *pg,
                       displayCallback display);
 
@@ -47,10 +135,72 @@ int piglutInitFunc(void *pg,
 
 int piglutMainLoop(void *pg);
 
+/* makes piglutMainLoop() return after the current frame, safe to call from
+   any thread */
+int piglutLeaveMainLoop(void *pg);
+
 int piglutSetUserData(void *pg, void * userData);
 
 void * piglutGetUserData(void *pg);
 
+/* opt in to partial updates.  When enabled, displayCb is only called for
+   frames with damage posted via piglutPostDamage(), once per merged region
+   with the scissor test set to that region, and piglut swaps the buffers.
+   With nothing to draw the main loop sleeps, as in event driven mode, until
+   input, a timer, a message or piglutPostRedisplay() wakes it.
+   displayCb must not call eglSwapBuffers() itself in this mode */
+int piglutSetPartialUpdate(void *pg, bool enable);
+
+/* marks a region of every output as needing a redraw on the next frame,
+   main thread only */
+int piglutPostDamage(void *pg, const piglutRect_t * rect);
+
+/* as above, for a single output */
+int piglutPostOutputDamage(void *pg, int output, const piglutRect_t * rect);
+
+/* publishes each completed frame of an output for other processes to read,
+   through a ring of buffers (2 to PIGLUT_FRAMES_MAX_BUFFERS) in shared
+   memory laid out as in piglutframes.h, which also has the reader.  Returns
+   the memfd to give them, over a unix socket or as /proc/<pid>/fd/<fd>
+   (it is close on exec).  It is filled in once the output is open, before
+   that readers see an empty file.
+
+   Each frame is copied with glReadPixels() on the main loop, just before
+   it is swapped (GLES2 has no asynchronous readback), and readers then use
+   the copy in place.  Outside partial update mode displayCb should swap
+   with piglutSwapBuffers().  Frames swapped with plain eglSwapBuffers() are
+   only exported where the back buffer can be preserved across the swap
+   (piglut asks for it), and are otherwise dropped with a warning */
+int piglutExportFrames(void *pg, int output, unsigned int buffers);
+
+/* eglSwapBuffers() for the output being drawn, exporting the frame first */
+int piglutSwapBuffers(void *pg);
+
+int piglutGetStats(void *pg, piglutStats_t * stats);
+
+/* when enabled the main loop sleeps until there is input, a timer fires or
+   a frame is requested, and displayCb is only called for the first frame
+   and requested ones */
+int piglutSetEventDriven(void *pg, bool enable);
+
+/* requests a call to displayCb, safe to call from any thread */
+int piglutPostRedisplay(void *pg);
+
+/* one shot, calls timer(pg, value) on the main loop once msecs have passed.
+   Main thread only */
+int piglutTimerFunc(void *pg, unsigned int msecs,
+                    timerCallback timer, int value);
+
+/* receives messages from piglutSendMessage(), called on the main loop for
+   everything queued so far just before each display */
+int piglutMessageFunc(void *pg,
+                      messageCallback message);
+
+/* copies size bytes (at most PIGLUT_MESSAGE_SIZE) into a lock free queue and
+   wakes the main loop.  Safe from any thread and never blocks, fails with
+   EAGAIN if the queue is full.  Pass larger payloads by pointer */
+int piglutSendMessage(void *pg, int type, const void *data, unsigned int size);
+
 #ifdef __cplusplus
 }
 #endif
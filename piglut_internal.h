@@ -0,0 +1,327 @@
+#ifndef _PIGLUT_INTERNAL_H_
+#define _PIGLUT_INTERNAL_H_
+
+/* state shared between piglut's own source files, not for applications */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <termios.h>
+#include <time.h>
+
+#ifndef PIGLUT_HEADLESS
+#include "bcm_host.h"
+#endif
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+#include "piglut.h"
+#include "piglutres.h"
+#include "piglutframes.h"
+
+#ifndef EGL_BUFFER_AGE_EXT
+#define EGL_BUFFER_AGE_EXT 0x313D
+#endif
+
+#ifdef PIGLUT_HEADLESS
+/* no display hardware, outputs are pbuffers of the requested size */
+#define OUTPUT_SURFACE_TYPE EGL_PBUFFER_BIT
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+typedef EGLDisplay (EGLAPIENTRYP getPlatformDisplayFunc)(EGLenum platform,
+                                                         void *nativeDisplay,
+                                                         const EGLint *attribList);
+#else
+#define OUTPUT_SURFACE_TYPE EGL_WINDOW_BIT
+#endif
+
+/* matches both the KHR and EXT flavours of swap buffers with damage */
+typedef EGLBoolean (EGLAPIENTRYP swapBuffersWithDamageFunc)(EGLDisplay dpy,
+                                                            EGLSurface surface,
+                                                            EGLint *rects,
+                                                            EGLint nRects);
+
+/* damage posted in one frame before it gets merged */
+#define MAX_DAMAGE_RECTS 16
+/* upper bound on the scissor regions drawn (and displayCb calls) per frame */
+#define MAX_DAMAGE_REGIONS 4
+/* frames of damage remembered for buffer age, enough for triple buffering */
+#define DAMAGE_HISTORY 3
+
+#define MAX_OUTPUTS 4
+
+/* GL state cache, see piglutgl.c */
+#define GL_STATE_UNKNOWN 0xFFFFFFFFU
+#define GL_STATE_TEXTURE_UNITS 8
+#define GL_STATE_ATTRIBS 16
+/* direct mapped, must be a power of two */
+#define UNIFORM_CACHE_SIZE 1024
+
+#define MAX_TIMERS 32
+
+/* what --piglut-latency asks for, see piglut.h */
+#define LATENCY_FIFO_PRIORITY 50
+#define LATENCY_PREFAULT_KB 256
+/* stack assumed to be in use already when prefaulting */
+#define STACK_MARGIN (64 * 1024)
+
+/* must be a power of two */
+#define MESSAGE_QUEUE_DEPTH 256
+#define CACHE_LINE_SIZE 64
+
+typedef struct
+{
+   struct timespec deadline;
+   timerCallback timer;
+   int value;
+} pendingTimer_t;
+
+typedef struct
+{
+   /* position this slot is waiting for, see the queue functions */
+   unsigned int sequence;
+   int type;
+   unsigned int size;
+   unsigned char data[PIGLUT_MESSAGE_SIZE];
+} messageSlot_t;
+
+/* bounded multi producer, single consumer ring (after Dmitry Vyukov's
+   bounded queue).  The positions live on their own cache lines so the
+   producers and the main loop don't fight over them */
+typedef struct
+{
+   unsigned int enqueuePos;
+   unsigned char pad0[CACHE_LINE_SIZE - sizeof(unsigned int)];
+   unsigned int dequeuePos;
+   unsigned char pad1[CACHE_LINE_SIZE - sizeof(unsigned int)];
+   messageSlot_t slots[MESSAGE_QUEUE_DEPTH];
+} messageQueue_t;
+
+/* what piglut last set on a context, GL_STATE_UNKNOWN (or the known
+   masks) covers anything it hasn't seen set */
+typedef struct
+{
+   GLuint program;
+   GLenum activeTexture;
+   /* per unit, 2D and cube map */
+   GLuint textures[GL_STATE_TEXTURE_UNITS][2];
+   GLuint arrayBuffer;
+   GLuint elementArrayBuffer;
+   unsigned int capsKnown;
+   unsigned int capsEnabled;
+   unsigned int attribsKnown;
+   unsigned int attribsEnabled;
+   GLenum blend[4];
+   GLenum depthFunc;
+   GLenum cullFace;
+   unsigned int depthMask;
+   bool viewportKnown;
+   GLint viewport[4];
+   bool scissorKnown;
+   GLint scissor[4];
+   bool clearColorKnown;
+   GLfloat clearColor[4];
+} glState_t;
+
+/* uniform values belong to the program, so this is shared by every
+   context.  An empty entry has program 0 */
+typedef struct
+{
+   GLuint program;
+   GLint location;
+   GLenum type;
+   GLfloat value[16];
+} uniformCacheEntry_t;
+
+/* a tracked texture or buffer, see piglutres.c.  Resident ones are on the
+   LRU list, free slots are chained through next */
+typedef struct
+{
+   /* GL_TEXTURE_2D, GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER, 0 if free */
+   GLenum target;
+   /* 0 while evicted */
+   GLuint name;
+   GLsizei width;
+   GLsizei height;
+   GLenum format;
+   GLenum type;
+   size_t size;
+   piglutReloadCallback reload;
+   void * userData;
+   unsigned int lastUsed;
+   bool used;
+   int prev;
+   int next;
+} resource_t;
+
+/* frames published for other processes, see piglutexport.c */
+typedef struct
+{
+   /* -1 when not exporting */
+   int fd;
+   unsigned int output;
+   unsigned int bufferCount;
+   /* mapped once the output is open */
+   piglutFrameHeader_t * header;
+   size_t size;
+   bool readFormatChosen;
+   GLenum readFormat;
+   GLenum readType;
+   /* read back as RGBA and packed down to header->format */
+   bool convert;
+   /* this frame has already gone out */
+   bool captured;
+   /* the back buffer survives eglSwapBuffers(), so a frame can still be
+      read after displayCb swapped it itself */
+   bool preserved;
+   bool warned;
+} frameExport_t;
+
+/* one per display being driven */
+typedef struct
+{
+   unsigned int displayId;
+   unsigned int width;
+   unsigned int height;
+   unsigned int panelWidth;
+   unsigned int panelHeight;
+   unsigned int bpp;
+
+   /* EGL */
+   EGLConfig config;
+   EGLSurface surface;
+   EGLContext context;
+   glState_t glState;
+
+#ifndef PIGLUT_HEADLESS
+   /* dispmax stuff */
+   EGL_DISPMANX_WINDOW_T nativeWindow;
+   DISPMANX_ELEMENT_HANDLE_T dispmanElement;
+   DISPMANX_DISPLAY_HANDLE_T dispmanDisplay;
+#endif
+
+   /* partial update */
+   bool bufferAgeSupported;
+   bool bufferPreserved;
+   piglutRect_t damage[MAX_DAMAGE_RECTS];
+   unsigned int damageCount;
+   piglutRect_t damageHistory[DAMAGE_HISTORY][MAX_DAMAGE_REGIONS];
+   unsigned int damageHistoryCount[DAMAGE_HISTORY];
+   unsigned int damageHistoryHead;
+} output_t;
+
+typedef struct
+{
+   bool widthFromCmdLine;
+   bool heightFromCmdLine;
+   bool bppFromCmdLine;
+
+   /* latency profile, applied by piglutMainLoop().  cpu -1 and priority 0
+      leave the scheduling alone */
+   int cpu;
+   int fifoPriority;
+   bool lockMemory;
+   unsigned int prefaultKB;
+
+   /* callbacks */
+   displayCallback displayCb;
+   keyboardCallback keyboardCb;
+   initCallback initCb;
+   messageCallback messageCb;
+
+   /* set by anything to terminate the main loop */
+   bool terminate;
+
+   /* EGL, shared by all outputs */
+   EGLDisplay display;
+
+   /* output 0 always exists and is configured by piglutInitWindowSize() */
+   output_t outputs[MAX_OUTPUTS];
+   unsigned int outputCount;
+   /* the output displayCb is drawing */
+   unsigned int currentOutput;
+   /* cache for whichever output's context is current, NULL before that */
+   glState_t * glState;
+   uniformCacheEntry_t * uniformCache;
+
+   /* GPU resource tracker, lruHead is the most recently used */
+   resource_t * resources;
+   unsigned int resourceCapacity;
+   int resourceFree;
+   int lruHead;
+   int lruTail;
+   size_t gpuBudget;
+   /* counts main loop iterations that draw, for the LRU */
+   unsigned int frameNumber;
+
+   frameExport_t exporter;
+
+   /* reused by piglutCommandListSubmit() */
+   void * submitScratch;
+   size_t submitScratchSize;
+
+   /* keyboard input */
+   struct termios oldTerminalConfig;
+   int peekCharacter;
+   bool keyboardClosed;
+
+   /* event loop, the pending flags are accessed atomically */
+   bool eventDriven;
+   int redisplayPending;
+   int wakePending;
+   int wakeFd;
+   int timerFd;
+   pendingTimer_t timers[MAX_TIMERS];
+   unsigned int timerCount;
+
+   messageQueue_t messages;
+
+   /* user data */
+   void * userData;
+
+   /* partial update */
+   bool partialUpdate;
+   swapBuffersWithDamageFunc swapBuffersWithDamage;
+
+   piglutStats_t stats;
+} piglut_t;
+
+#define MAX(a,b) \
+   ({ __typeof__ (a) _a = (a); \
+      __typeof__ (b) _b = (b); \
+      _a > _b ? _a : _b; })
+
+#define MIN(a,b) \
+   ({ __typeof__ (a) _a = (a); \
+      __typeof__ (b) _b = (b); \
+      _a < _b ? _a : _b; })
+
+#define MAX_WIDTH 1920
+#define MAX_HEIGHT 1080
+
+/* shared between piglut's own files (and the benchmarks and tests, which
+   build from source), but not part of libpiglut.so's interface */
+#define PIGLUT_HIDDEN __attribute__((visibility("hidden")))
+
+/* piglut.c, the config request made for each output */
+PIGLUT_HIDDEN bool piglutChooseConfig(piglut_t * p, unsigned int bpp, EGLConfig * config);
+
+/* piglutgl.c */
+PIGLUT_HIDDEN void piglutGLStateReset(glState_t * s);
+PIGLUT_HIDDEN void piglutGLStateEnable(piglut_t * p, GLenum cap, bool enable);
+PIGLUT_HIDDEN void piglutGLStateScissor(piglut_t * p, GLint x, GLint y, GLsizei width, GLsizei height);
+PIGLUT_HIDDEN void piglutGLStateForgetScissor(glState_t * s);
+
+/* piglutres.c */
+PIGLUT_HIDDEN void piglutResourcesTerm(piglut_t * p);
+
+/* piglutexport.c */
+PIGLUT_HIDDEN void piglutExportSetup(piglut_t * p);
+PIGLUT_HIDDEN void piglutExportCapture(piglut_t * p, unsigned int output);
+PIGLUT_HIDDEN void piglutExportAfterDisplay(piglut_t * p, unsigned int output);
+PIGLUT_HIDDEN void piglutExportTerm(piglut_t * p);
+
+#endif /* _PIGLUT_INTERNAL_H_ */
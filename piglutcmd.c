@@ -0,0 +1,460 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "piglut_internal.h"
+#include "piglutgl.h"
+#include "piglutcmd.h"
+
+#define INITIAL_ARENA_SIZE 4096
+#define INITIAL_PACKETS 64
+
+enum
+{
+   CMD_USE_PROGRAM,
+   CMD_BIND_TEXTURE,
+   CMD_BIND_BUFFER,
+   CMD_VERTEX_ATTRIB_POINTER,
+   CMD_ENABLE_VERTEX_ATTRIB_ARRAY,
+   CMD_DISABLE_VERTEX_ATTRIB_ARRAY,
+   CMD_ENABLE,
+   CMD_DISABLE,
+   CMD_BLEND_FUNC,
+   CMD_UNIFORM_1I,
+   CMD_UNIFORM_1F,
+   CMD_UNIFORM_4FV,
+   CMD_UNIFORM_MATRIX_4FV,
+   CMD_DRAW_ARRAYS,
+   CMD_DRAW_ELEMENTS
+};
+
+/* every command has the same header, uniform values follow it in the
+   arena.  size covers both and keeps the next command aligned */
+typedef struct
+{
+   unsigned short op;
+   unsigned short size;
+   GLuint arg[5];
+   GLintptr offset;
+} command_t;
+
+typedef struct
+{
+   unsigned long long key;
+   /* arena offsets of its first command and one past its last */
+   size_t start;
+   size_t end;
+} packet_t;
+
+struct piglutCommandList
+{
+   unsigned char * arena;
+   size_t used;
+   size_t capacity;
+   packet_t * packets;
+   unsigned int packetCount;
+   unsigned int packetCapacity;
+};
+
+/* what gets sorted at submit time */
+typedef struct
+{
+   unsigned long long key;
+   unsigned int list;
+   unsigned int packet;
+} packetRef_t;
+
+piglutCommandList_t * piglutCommandListCreate(void)
+{
+   piglutCommandList_t * cl = (piglutCommandList_t *)calloc(1, sizeof(piglutCommandList_t));
+   if (cl)
+   {
+      cl->arena = (unsigned char *)malloc(INITIAL_ARENA_SIZE);
+      cl->packets = (packet_t *)malloc(INITIAL_PACKETS * sizeof(packet_t));
+      if (!cl->arena || !cl->packets)
+      {
+         piglutCommandListDestroy(cl);
+         errno = ENOMEM;
+         return NULL;
+      }
+      cl->capacity = INITIAL_ARENA_SIZE;
+      cl->packetCapacity = INITIAL_PACKETS;
+   }
+
+   /* NULL on error */
+   return cl;
+}
+
+void piglutCommandListDestroy(piglutCommandList_t * cl)
+{
+   if (cl)
+   {
+      free(cl->arena);
+      free(cl->packets);
+      free(cl);
+   }
+}
+
+void piglutCommandListReset(piglutCommandList_t * cl)
+{
+   if (cl)
+   {
+      cl->used = 0;
+      cl->packetCount = 0;
+   }
+}
+
+int piglutCmdBegin(piglutCommandList_t * cl, unsigned long long sortKey)
+{
+   if (!cl)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   if (cl->packetCount == cl->packetCapacity)
+   {
+      packet_t * packets = (packet_t *)realloc(cl->packets, cl->packetCapacity * 2 * sizeof(packet_t));
+      if (!packets)
+      {
+         errno = ENOMEM;
+         return -1;
+      }
+      cl->packets = packets;
+      cl->packetCapacity *= 2;
+   }
+
+   cl->packets[cl->packetCount].key = sortKey;
+   cl->packets[cl->packetCount].start = cl->used;
+   cl->packets[cl->packetCount].end = cl->used;
+   cl->packetCount++;
+   return 0;
+}
+
+/* appends a command with room for values bytes after it, the pointer is
+   only good until the next append */
+static command_t * append(piglutCommandList_t * cl, unsigned int op, size_t values)
+{
+   size_t size = (sizeof(command_t) + values + sizeof(GLintptr) - 1) & ~(sizeof(GLintptr) - 1);
+   command_t * c;
+
+   if (!cl)
+   {
+      errno = EINVAL;
+      return NULL;
+   }
+
+   if ((cl->packetCount == 0) && piglutCmdBegin(cl, 0))
+      return NULL;
+
+   if (cl->used + size > cl->capacity)
+   {
+      size_t capacity = cl->capacity * 2;
+      unsigned char * arena;
+
+      while (cl->used + size > capacity)
+         capacity *= 2;
+      arena = (unsigned char *)realloc(cl->arena, capacity);
+      if (!arena)
+      {
+         errno = ENOMEM;
+         return NULL;
+      }
+      cl->arena = arena;
+      cl->capacity = capacity;
+   }
+
+   c = (command_t *)(cl->arena + cl->used);
+   c->op = op;
+   c->size = size;
+   cl->used += size;
+   cl->packets[cl->packetCount - 1].end = cl->used;
+   return c;
+}
+
+int piglutCmdUseProgram(piglutCommandList_t * cl, GLuint program)
+{
+   command_t * c = append(cl, CMD_USE_PROGRAM, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = program;
+   return 0;
+}
+
+int piglutCmdBindTexture(piglutCommandList_t * cl, GLenum unit, GLenum target, GLuint texture)
+{
+   command_t * c = append(cl, CMD_BIND_TEXTURE, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = unit;
+   c->arg[1] = target;
+   c->arg[2] = texture;
+   return 0;
+}
+
+int piglutCmdBindBuffer(piglutCommandList_t * cl, GLenum target, GLuint buffer)
+{
+   command_t * c = append(cl, CMD_BIND_BUFFER, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = target;
+   c->arg[1] = buffer;
+   return 0;
+}
+
+int piglutCmdVertexAttribPointer(piglutCommandList_t * cl, GLuint index, GLint size,
+                                 GLenum type, GLboolean normalized, GLsizei stride,
+                                 GLintptr offset)
+{
+   command_t * c = append(cl, CMD_VERTEX_ATTRIB_POINTER, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = index;
+   c->arg[1] = (GLuint)size;
+   c->arg[2] = type;
+   c->arg[3] = normalized;
+   c->arg[4] = (GLuint)stride;
+   c->offset = offset;
+   return 0;
+}
+
+static int appendIndex(piglutCommandList_t * cl, unsigned int op, GLuint value)
+{
+   command_t * c = append(cl, op, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = value;
+   return 0;
+}
+
+int piglutCmdEnableVertexAttribArray(piglutCommandList_t * cl, GLuint index)
+{
+   return appendIndex(cl, CMD_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+int piglutCmdDisableVertexAttribArray(piglutCommandList_t * cl, GLuint index)
+{
+   return appendIndex(cl, CMD_DISABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+int piglutCmdEnable(piglutCommandList_t * cl, GLenum cap)
+{
+   return appendIndex(cl, CMD_ENABLE, cap);
+}
+
+int piglutCmdDisable(piglutCommandList_t * cl, GLenum cap)
+{
+   return appendIndex(cl, CMD_DISABLE, cap);
+}
+
+int piglutCmdBlendFunc(piglutCommandList_t * cl, GLenum sfactor, GLenum dfactor)
+{
+   command_t * c = append(cl, CMD_BLEND_FUNC, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = sfactor;
+   c->arg[1] = dfactor;
+   return 0;
+}
+
+int piglutCmdUniform1i(piglutCommandList_t * cl, GLint location, GLint x)
+{
+   command_t * c = append(cl, CMD_UNIFORM_1I, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = (GLuint)location;
+   c->arg[1] = (GLuint)x;
+   return 0;
+}
+
+static int appendUniform(piglutCommandList_t * cl, unsigned int op, GLint location,
+                         const GLfloat * v, unsigned int n)
+{
+   command_t * c;
+
+   if (!v)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   c = append(cl, op, n * sizeof(GLfloat));
+   if (!c)
+      return -1;
+   c->arg[0] = (GLuint)location;
+   memcpy(c + 1, v, n * sizeof(GLfloat));
+   return 0;
+}
+
+int piglutCmdUniform1f(piglutCommandList_t * cl, GLint location, GLfloat x)
+{
+   return appendUniform(cl, CMD_UNIFORM_1F, location, &x, 1);
+}
+
+int piglutCmdUniform4fv(piglutCommandList_t * cl, GLint location, const GLfloat *v)
+{
+   return appendUniform(cl, CMD_UNIFORM_4FV, location, v, 4);
+}
+
+int piglutCmdUniformMatrix4fv(piglutCommandList_t * cl, GLint location, const GLfloat *value)
+{
+   return appendUniform(cl, CMD_UNIFORM_MATRIX_4FV, location, value, 16);
+}
+
+int piglutCmdDrawArrays(piglutCommandList_t * cl, GLenum mode, GLint first, GLsizei count)
+{
+   command_t * c = append(cl, CMD_DRAW_ARRAYS, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = mode;
+   c->arg[1] = (GLuint)first;
+   c->arg[2] = (GLuint)count;
+   return 0;
+}
+
+int piglutCmdDrawElements(piglutCommandList_t * cl, GLenum mode, GLsizei count,
+                          GLenum type, GLintptr offset)
+{
+   command_t * c = append(cl, CMD_DRAW_ELEMENTS, 0);
+   if (!c)
+      return -1;
+   c->arg[0] = mode;
+   c->arg[1] = (GLuint)count;
+   c->arg[2] = type;
+   c->offset = offset;
+   return 0;
+}
+
+static int comparePackets(const void * a, const void * b)
+{
+   const packetRef_t * x = (const packetRef_t *)a;
+   const packetRef_t * y = (const packetRef_t *)b;
+
+   if (x->key != y->key)
+      return (x->key < y->key) ? -1 : 1;
+   if (x->list != y->list)
+      return (x->list < y->list) ? -1 : 1;
+   if (x->packet != y->packet)
+      return (x->packet < y->packet) ? -1 : 1;
+   return 0;
+}
+
+static void replay(void * pg, const unsigned char * arena, size_t start, size_t end)
+{
+   while (start < end)
+   {
+      const command_t * c = (const command_t *)(arena + start);
+      const GLfloat * values = (const GLfloat *)(c + 1);
+
+      switch (c->op)
+      {
+      case CMD_USE_PROGRAM:
+         piglutUseProgram(pg, c->arg[0]);
+         break;
+      case CMD_BIND_TEXTURE:
+         piglutActiveTexture(pg, c->arg[0]);
+         piglutBindTexture(pg, c->arg[1], c->arg[2]);
+         break;
+      case CMD_BIND_BUFFER:
+         piglutBindBuffer(pg, c->arg[0], c->arg[1]);
+         break;
+      case CMD_VERTEX_ATTRIB_POINTER:
+         glVertexAttribPointer(c->arg[0], (GLint)c->arg[1], c->arg[2], (GLboolean)c->arg[3],
+                               (GLsizei)c->arg[4], (const void *)c->offset);
+         break;
+      case CMD_ENABLE_VERTEX_ATTRIB_ARRAY:
+         piglutEnableVertexAttribArray(pg, c->arg[0]);
+         break;
+      case CMD_DISABLE_VERTEX_ATTRIB_ARRAY:
+         piglutDisableVertexAttribArray(pg, c->arg[0]);
+         break;
+      case CMD_ENABLE:
+         piglutEnable(pg, c->arg[0]);
+         break;
+      case CMD_DISABLE:
+         piglutDisable(pg, c->arg[0]);
+         break;
+      case CMD_BLEND_FUNC:
+         piglutBlendFunc(pg, c->arg[0], c->arg[1]);
+         break;
+      case CMD_UNIFORM_1I:
+         piglutUniform1i(pg, (GLint)c->arg[0], (GLint)c->arg[1]);
+         break;
+      case CMD_UNIFORM_1F:
+         piglutUniform1f(pg, (GLint)c->arg[0], values[0]);
+         break;
+      case CMD_UNIFORM_4FV:
+         piglutUniform4fv(pg, (GLint)c->arg[0], 1, values);
+         break;
+      case CMD_UNIFORM_MATRIX_4FV:
+         piglutUniformMatrix4fv(pg, (GLint)c->arg[0], 1, GL_FALSE, values);
+         break;
+      case CMD_DRAW_ARRAYS:
+         glDrawArrays(c->arg[0], (GLint)c->arg[1], (GLsizei)c->arg[2]);
+         break;
+      case CMD_DRAW_ELEMENTS:
+         glDrawElements(c->arg[0], (GLsizei)c->arg[1], c->arg[2], (const void *)c->offset);
+         break;
+      }
+
+      start += c->size;
+   }
+}
+
+int piglutCommandListSubmit(void *pg, piglutCommandList_t * const * lists,
+                            unsigned int count)
+{
+   piglut_t * p = (piglut_t *)pg;
+   packetRef_t * refs;
+   unsigned int total = 0, n = 0, i, j;
+   bool sorted = true;
+
+   if (!p || (!lists && count))
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   for (i = 0; i < count; i++)
+      total += lists[i] ? lists[i]->packetCount : 0;
+
+   /* the scratch space is kept from frame to frame */
+   if (total * sizeof(packetRef_t) > p->submitScratchSize)
+   {
+      void * scratch = realloc(p->submitScratch, total * sizeof(packetRef_t));
+      if (!scratch)
+      {
+         errno = ENOMEM;
+         return -1;
+      }
+      p->submitScratch = scratch;
+      p->submitScratchSize = total * sizeof(packetRef_t);
+   }
+   refs = (packetRef_t *)p->submitScratch;
+
+   for (i = 0; i < count; i++)
+   {
+      for (j = 0; lists[i] && (j < lists[i]->packetCount); j++)
+      {
+         refs[n].key = lists[i]->packets[j].key;
+         refs[n].list = i;
+         refs[n].packet = j;
+         if ((n > 0) && (refs[n].key < refs[n - 1].key))
+            sorted = false;
+         n++;
+      }
+   }
+
+   /* static lists recorded in key order don't need sorting every frame */
+   if (!sorted)
+      qsort(refs, n, sizeof(packetRef_t), comparePackets);
+
+   for (i = 0; i < n; i++)
+   {
+      const piglutCommandList_t * cl = lists[refs[i].list];
+      const packet_t * packet = &cl->packets[refs[i].packet];
+      replay(pg, cl->arena, packet->start, packet->end);
+   }
+
+   return 0;
+}
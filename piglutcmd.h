@@ -0,0 +1,70 @@
+#ifndef _PIGLUTCMD_H_
+#define _PIGLUTCMD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <GLES2/gl2.h>
+
+/* Command lists let draw preparation happen on any thread.  Commands are
+   recorded into packets, each started by piglutCmdBegin() with a sort key,
+   and piglutCommandListSubmit() replays every packet of every list given in
+   key order on the render thread.  Packets with equal keys keep the order
+   they were recorded in (list by list).
+
+   Put the most expensive state in the top bits of the key (say program,
+   then texture) so that packets sharing state end up next to each other;
+   replay goes through the piglutgl.h state cache, which then drops the
+   repeated binds.
+
+   A list may be recorded by one thread at a time and must not be recorded
+   while it is being submitted.  A list that isn't reset can be submitted
+   every frame, like a display list.  Recording functions return 0, or -1
+   with errno set to ENOMEM */
+
+typedef struct piglutCommandList piglutCommandList_t;
+
+piglutCommandList_t * piglutCommandListCreate(void);
+void piglutCommandListDestroy(piglutCommandList_t * cl);
+
+/* empties the list for recording again, keeping its memory */
+void piglutCommandListReset(piglutCommandList_t * cl);
+
+/* starts a packet, commands recorded before the first one get key 0 */
+int piglutCmdBegin(piglutCommandList_t * cl, unsigned long long sortKey);
+
+int piglutCmdUseProgram(piglutCommandList_t * cl, GLuint program);
+/* unit is GL_TEXTURE0 + n */
+int piglutCmdBindTexture(piglutCommandList_t * cl, GLenum unit, GLenum target, GLuint texture);
+int piglutCmdBindBuffer(piglutCommandList_t * cl, GLenum target, GLuint buffer);
+/* offset is into the bound GL_ARRAY_BUFFER */
+int piglutCmdVertexAttribPointer(piglutCommandList_t * cl, GLuint index, GLint size,
+                                 GLenum type, GLboolean normalized, GLsizei stride,
+                                 GLintptr offset);
+int piglutCmdEnableVertexAttribArray(piglutCommandList_t * cl, GLuint index);
+int piglutCmdDisableVertexAttribArray(piglutCommandList_t * cl, GLuint index);
+int piglutCmdEnable(piglutCommandList_t * cl, GLenum cap);
+int piglutCmdDisable(piglutCommandList_t * cl, GLenum cap);
+int piglutCmdBlendFunc(piglutCommandList_t * cl, GLenum sfactor, GLenum dfactor);
+
+/* values are copied when recorded */
+int piglutCmdUniform1i(piglutCommandList_t * cl, GLint location, GLint x);
+int piglutCmdUniform1f(piglutCommandList_t * cl, GLint location, GLfloat x);
+int piglutCmdUniform4fv(piglutCommandList_t * cl, GLint location, const GLfloat *v);
+int piglutCmdUniformMatrix4fv(piglutCommandList_t * cl, GLint location, const GLfloat *value);
+
+int piglutCmdDrawArrays(piglutCommandList_t * cl, GLenum mode, GLint first, GLsizei count);
+/* offset is into the bound GL_ELEMENT_ARRAY_BUFFER */
+int piglutCmdDrawElements(piglutCommandList_t * cl, GLenum mode, GLsizei count,
+                          GLenum type, GLintptr offset);
+
+/* replays the lists on the current context, render thread only */
+int piglutCommandListSubmit(void *pg, piglutCommandList_t * const * lists,
+                            unsigned int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PIGLUTCMD_H_ */
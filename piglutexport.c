@@ -0,0 +1,309 @@
+/* memfd_create() */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "piglut_internal.h"
+#include "piglutframes.h"
+
+static size_t pageAlign(size_t size)
+{
+   size_t page = (size_t)sysconf(_SC_PAGESIZE);
+   return (size + page - 1) & ~(page - 1);
+}
+
+static unsigned int bytesPerPixel(unsigned int format)
+{
+   switch (format)
+   {
+   case PIGLUT_FRAMES_RGB565: return 2;
+   case PIGLUT_FRAMES_RGB888: return 3;
+   default:                   return 4;
+   }
+}
+
+/* sizes and fills in the header, once the output's final size is known */
+static int mapExport(piglut_t * p)
+{
+   frameExport_t * e = &p->exporter;
+   output_t * o = &p->outputs[e->output];
+   piglutFrameHeader_t * h;
+   unsigned int format;
+   size_t headerSize, bufferSize, size;
+
+   if (o->bpp == 16)
+      format = PIGLUT_FRAMES_RGB565;
+   else if (o->bpp == 24)
+      format = PIGLUT_FRAMES_RGB888;
+   else
+      format = PIGLUT_FRAMES_RGBA8888;
+
+   /* room to read back as RGBA and pack down in place if the GPU can't
+      give us the format directly */
+   headerSize = pageAlign(sizeof(piglutFrameHeader_t));
+   bufferSize = pageAlign((size_t)o->width * 4 * o->height);
+   size = headerSize + bufferSize * e->bufferCount;
+
+   if ((bufferSize > UINT_MAX) || (ftruncate(e->fd, (off_t)size) != 0))
+      return -1;
+   /* readers can trust the size from now on */
+   fcntl(e->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+   h = (piglutFrameHeader_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, e->fd, 0);
+   if (h == MAP_FAILED)
+      return -1;
+
+   h->version = PIGLUT_FRAMES_VERSION;
+   h->width = o->width;
+   h->height = o->height;
+   /* glReadPixels() rows, at the default pack alignment of 4 */
+   h->stride = (o->width * bytesPerPixel(format) + 3) & ~3U;
+   h->format = format;
+   h->bufferCount = e->bufferCount;
+   h->headerSize = (unsigned int)headerSize;
+   h->bufferSize = (unsigned int)bufferSize;
+   /* last, readers check it before anything else */
+   __atomic_store_n(&h->magic, PIGLUT_FRAMES_MAGIC, __ATOMIC_RELEASE);
+
+   e->header = h;
+   e->size = size;
+   return 0;
+}
+
+/* with the exported output current */
+static void chooseReadFormat(frameExport_t * e)
+{
+   GLint format = 0, type = 0;
+
+   /* RGBA bytes always work, the other pair is up to the implementation */
+   e->readFormat = GL_RGBA;
+   e->readType = GL_UNSIGNED_BYTE;
+   glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT, &format);
+   glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE, &type);
+
+   if ((e->header->format == PIGLUT_FRAMES_RGB565) &&
+       (format == GL_RGB) && (type == GL_UNSIGNED_SHORT_5_6_5))
+   {
+      e->readFormat = GL_RGB;
+      e->readType = GL_UNSIGNED_SHORT_5_6_5;
+   }
+   else if ((e->header->format == PIGLUT_FRAMES_RGB888) &&
+            (format == GL_RGB) && (type == GL_UNSIGNED_BYTE))
+      e->readFormat = GL_RGB;
+
+   e->convert = (e->readFormat == GL_RGBA) && (e->header->format != PIGLUT_FRAMES_RGBA8888);
+   e->readFormatChosen = true;
+}
+
+/* packs RGBA rows down to the exported format.  Going forwards, each
+   destination pixel is at or before its source, so it can be done in place */
+static void convert(const piglutFrameHeader_t * h, unsigned char * pixels)
+{
+   size_t srcStride = (size_t)h->width * 4;
+   unsigned int x, y;
+
+   for (y = 0; y < h->height; y++)
+   {
+      const unsigned char * src = pixels + y * srcStride;
+      unsigned char * dst = pixels + y * (size_t)h->stride;
+
+      if (h->format == PIGLUT_FRAMES_RGB565)
+      {
+         for (x = 0; x < h->width; x++, src += 4, dst += 2)
+         {
+            unsigned short v = (unsigned short)(((src[0] >> 3) << 11) |
+                                                ((src[1] >> 2) << 5) |
+                                                (src[2] >> 3));
+            memcpy(dst, &v, sizeof(v));
+         }
+      }
+      else
+      {
+         for (x = 0; x < h->width; x++, src += 4, dst += 3)
+         {
+            unsigned char r = src[0], g = src[1], b = src[2];
+            dst[0] = r;
+            dst[1] = g;
+            dst[2] = b;
+         }
+      }
+   }
+}
+
+/* whether a frame swapped by the app itself can still be read back,
+   asking EGL to keep the back buffer if it can */
+static bool preserveBackBuffer(piglut_t * p, output_t * o)
+{
+   EGLint value;
+
+   /* swapping a pbuffer does nothing */
+   if (OUTPUT_SURFACE_TYPE == EGL_PBUFFER_BIT)
+      return true;
+
+   if (eglQuerySurface(p->display, o->surface, EGL_SWAP_BEHAVIOR, &value) &&
+       (value == EGL_BUFFER_PRESERVED))
+      return true;
+
+   return eglGetConfigAttrib(p->display, o->config, EGL_SURFACE_TYPE, &value) &&
+          (value & EGL_SWAP_BEHAVIOR_PRESERVED_BIT) &&
+          eglSurfaceAttrib(p->display, o->surface, EGL_SWAP_BEHAVIOR, EGL_BUFFER_PRESERVED);
+}
+
+void piglutExportSetup(piglut_t * p)
+{
+   frameExport_t * e = &p->exporter;
+
+   if ((e->fd >= 0) && !e->header)
+   {
+      if (mapExport(p) != 0)
+      {
+         /* leave readers with an empty file rather than a half made one */
+         close(e->fd);
+         e->fd = -1;
+         return;
+      }
+      e->preserved = preserveBackBuffer(p, &p->outputs[e->output]);
+   }
+}
+
+void piglutExportCapture(piglut_t * p, unsigned int output)
+{
+   frameExport_t * e = &p->exporter;
+   piglutFrameHeader_t * h = e->header;
+   piglutFrameSlot_t * slot;
+   unsigned char * pixels;
+   unsigned int n, buffer;
+   GLint packAlignment = 4;
+   struct timespec now;
+
+   if (!h || (output != e->output) || e->captured)
+      return;
+   e->captured = true;
+
+   if (!e->readFormatChosen)
+      chooseReadFormat(e);
+
+   /* only the writer changes frames, so a plain read is fine here */
+   n = h->frames;
+   buffer = n % h->bufferCount;
+   slot = &h->slots[buffer];
+   pixels = (unsigned char *)h + h->headerSize + (size_t)buffer * h->bufferSize;
+
+   /* odd while writing, and the release fence keeps the pixel writes after
+      it for anyone reading */
+   __atomic_store_n(&slot->sequence, 2 * n + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+   if (packAlignment != 4)
+      glPixelStorei(GL_PACK_ALIGNMENT, 4);
+   glReadPixels(0, 0, (GLsizei)h->width, (GLsizei)h->height, e->readFormat, e->readType, pixels);
+   if (packAlignment != 4)
+      glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+   if (e->convert)
+      convert(h, pixels);
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   slot->timestamp = (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+
+   __atomic_store_n(&slot->sequence, 2 * n + 2, __ATOMIC_RELEASE);
+   __atomic_store_n(&h->frames, n + 1, __ATOMIC_SEQ_CST);
+
+   /* the syscall only when a reader is actually blocked */
+   if (__atomic_load_n(&h->waiters, __ATOMIC_SEQ_CST))
+      syscall(SYS_futex, &h->frames, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+   p->stats.framesExported++;
+}
+
+/* after displayCb, for a frame it didn't swap with piglutSwapBuffers().
+   If it swapped with eglSwapBuffers() the back buffer is only worth
+   reading when preserved, otherwise the frame is dropped */
+void piglutExportAfterDisplay(piglut_t * p, unsigned int output)
+{
+   frameExport_t * e = &p->exporter;
+
+   if (!e->header || (output != e->output) || e->captured)
+      return;
+
+   if (e->preserved)
+      piglutExportCapture(p, output);
+   else if (!e->warned)
+   {
+      fprintf(stderr, "piglut: frames are only exported when swapped with piglutSwapBuffers() "
+                      "on this display\n");
+      e->warned = true;
+   }
+}
+
+void piglutExportTerm(piglut_t * p)
+{
+   frameExport_t * e = &p->exporter;
+
+   if (e->header)
+      munmap(e->header, e->size);
+   if (e->fd >= 0)
+      close(e->fd);
+   e->header = NULL;
+   e->fd = -1;
+}
+
+int piglutExportFrames(void *pg, int output, unsigned int buffers)
+{
+   piglut_t * p = (piglut_t *)pg;
+
+   if (!p || (output < 0) || ((unsigned int)output >= p->outputCount) ||
+       (buffers < 2) || (buffers > PIGLUT_FRAMES_MAX_BUFFERS))
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   if (p->exporter.fd >= 0)
+   {
+      errno = EBUSY;
+      return -1;
+   }
+
+   p->exporter.fd = memfd_create("piglut-frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+   if (p->exporter.fd < 0)
+      return -1;
+
+   p->exporter.output = (unsigned int)output;
+   p->exporter.bufferCount = buffers;
+
+   /* the output's size is only final once it is open */
+   if (p->outputs[output].surface != EGL_NO_SURFACE)
+   {
+      piglutExportSetup(p);
+      if (p->exporter.fd < 0)
+         return -1;
+   }
+
+   return p->exporter.fd;
+}
+
+int piglutSwapBuffers(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+
+   if (!p || (p->display == EGL_NO_DISPLAY))
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   piglutExportCapture(p, p->currentOutput);
+   eglSwapBuffers(p->display, p->outputs[p->currentOutput].surface);
+   return 0;
+}
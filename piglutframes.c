@@ -0,0 +1,239 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "piglutframes.h"
+
+/* how often a reader that can't register as a waiter looks again */
+#define POLL_INTERVAL_NS 5000000L
+
+struct piglutFrameReader
+{
+   const piglutFrameHeader_t * header;
+   size_t size;
+   /* the header is writable, so the writer knows to wake us */
+   bool registered;
+};
+
+/* the header fields the writer changes, the rest is fixed once mapped */
+static unsigned int loadAcquire(const unsigned int *v)
+{
+   return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+}
+
+piglutFrameReader_t * piglutFrameReaderOpen(int fd)
+{
+   piglutFrameReader_t * r;
+   const piglutFrameHeader_t * h;
+   struct stat st;
+   void * mapping;
+   size_t needed;
+
+   if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(piglutFrameHeader_t)))
+   {
+      errno = EPROTO;
+      return NULL;
+   }
+
+   mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   if (mapping == MAP_FAILED)
+      return NULL;
+
+   h = (const piglutFrameHeader_t *)mapping;
+   needed = (size_t)h->headerSize + (size_t)h->bufferCount * h->bufferSize;
+   if ((h->magic != PIGLUT_FRAMES_MAGIC) || (h->version != PIGLUT_FRAMES_VERSION) ||
+       (h->bufferCount == 0) || (h->bufferCount > PIGLUT_FRAMES_MAX_BUFFERS) ||
+       ((size_t)h->stride * h->height > h->bufferSize) ||
+       (needed > (size_t)st.st_size))
+   {
+      munmap(mapping, (size_t)st.st_size);
+      errno = EPROTO;
+      return NULL;
+   }
+
+   r = (piglutFrameReader_t *)malloc(sizeof(piglutFrameReader_t));
+   if (!r)
+   {
+      munmap(mapping, (size_t)st.st_size);
+      errno = ENOMEM;
+      return NULL;
+   }
+   r->header = h;
+   r->size = (size_t)st.st_size;
+   /* only possible with a read/write descriptor, such as the exporter's own */
+   r->registered = (mprotect(mapping, h->headerSize, PROT_READ | PROT_WRITE) == 0);
+   return r;
+}
+
+piglutFrameReader_t * piglutFrameReaderOpenProcess(pid_t pid, int fd)
+{
+   piglutFrameReader_t * r;
+   char path[64];
+   int local;
+
+   snprintf(path, sizeof(path), "/proc/%d/fd/%d", (int)pid, fd);
+   local = open(path, O_RDWR | O_CLOEXEC);
+   if (local < 0)
+      local = open(path, O_RDONLY | O_CLOEXEC);
+   if (local < 0)
+      return NULL;
+
+   r = piglutFrameReaderOpen(local);
+   close(local);
+   return r;
+}
+
+void piglutFrameReaderClose(piglutFrameReader_t * r)
+{
+   if (r)
+   {
+      munmap((void *)r->header, r->size);
+      free(r);
+   }
+}
+
+/* fills in frame n if its buffer still holds it */
+static bool getFrame(piglutFrameReader_t * r, unsigned int n, piglutFrame_t * frame)
+{
+   const piglutFrameHeader_t * h = r->header;
+   unsigned int buffer = n % h->bufferCount;
+   const piglutFrameSlot_t * slot = &h->slots[buffer];
+
+   if (loadAcquire(&slot->sequence) != (2 * n + 2))
+      return false;
+
+   frame->pixels = (const unsigned char *)h + h->headerSize + (size_t)buffer * h->bufferSize;
+   frame->width = h->width;
+   frame->height = h->height;
+   frame->stride = h->stride;
+   frame->format = h->format;
+   frame->number = n;
+   frame->timestamp = slot->timestamp;
+
+   /* the timestamp is covered by the sequence as well */
+   return piglutFrameReaderValid(r, frame);
+}
+
+int piglutFrameReaderLatest(piglutFrameReader_t * r, piglutFrame_t * frame)
+{
+   if (!r || !frame)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   /* only fails if the writer laps us between the two loads, in which case
+      there is an even newer frame to try */
+   for (;;)
+   {
+      unsigned int frames = loadAcquire(&r->header->frames);
+
+      if (frames == 0)
+      {
+         errno = EAGAIN;
+         return -1;
+      }
+      if (getFrame(r, frames - 1, frame))
+         return 0;
+   }
+}
+
+static long futexWait(const unsigned int *address, unsigned int value,
+                      const struct timespec * timeout)
+{
+   /* not FUTEX_PRIVATE_FLAG, the word is shared between processes */
+   return syscall(SYS_futex, address, FUTEX_WAIT, value, timeout, NULL, 0);
+}
+
+int piglutFrameReaderWait(piglutFrameReader_t * r, unsigned int after,
+                          int timeoutMs, piglutFrame_t * frame)
+{
+   piglutFrameHeader_t * h;
+   struct timespec deadline;
+   int result = 0;
+
+   if (!r || !frame)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   /* the waiter count is the only thing readers write, and only when
+      registered */
+   h = (piglutFrameHeader_t *)r->header;
+
+   clock_gettime(CLOCK_MONOTONIC, &deadline);
+   deadline.tv_sec += timeoutMs / 1000;
+   deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+   if (deadline.tv_nsec >= 1000000000L)
+   {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+   }
+
+   if (r->registered)
+      __atomic_fetch_add(&h->waiters, 1, __ATOMIC_SEQ_CST);
+   for (;;)
+   {
+      unsigned int frames = __atomic_load_n(&h->frames, __ATOMIC_SEQ_CST);
+      struct timespec now, remaining;
+
+      /* anything after the one asked about, allowing for wrap */
+      if ((frames != 0) && ((int)(frames - 1 - after) > 0))
+         break;
+
+      remaining.tv_sec = 0;
+      remaining.tv_nsec = POLL_INTERVAL_NS;
+      if (timeoutMs >= 0)
+      {
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         now.tv_sec = deadline.tv_sec - now.tv_sec;
+         now.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+         if (now.tv_nsec < 0)
+         {
+            now.tv_sec--;
+            now.tv_nsec += 1000000000L;
+         }
+         if (now.tv_sec < 0)
+         {
+            result = -1;
+            break;
+         }
+         if (r->registered || ((now.tv_sec == 0) && (now.tv_nsec < remaining.tv_nsec)))
+            remaining = now;
+      }
+
+      futexWait(&h->frames, frames,
+                (r->registered && (timeoutMs < 0)) ? NULL : &remaining);
+   }
+   if (r->registered)
+      __atomic_fetch_sub(&h->waiters, 1, __ATOMIC_SEQ_CST);
+
+   if (result != 0)
+   {
+      errno = ETIMEDOUT;
+      return -1;
+   }
+   return piglutFrameReaderLatest(r, frame);
+}
+
+bool piglutFrameReaderValid(piglutFrameReader_t * r, const piglutFrame_t * frame)
+{
+   const piglutFrameHeader_t * h;
+
+   if (!r || !frame)
+      return false;
+
+   h = r->header;
+   /* orders the caller's reads of the pixels before the recheck */
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   return __atomic_load_n(&h->slots[frame->number % h->bufferCount].sequence, __ATOMIC_RELAXED) ==
+          (2 * frame->number + 2);
+}
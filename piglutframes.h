@@ -0,0 +1,105 @@
+#ifndef _PIGLUTFRAMES_H_
+#define _PIGLUTFRAMES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* Frames exported with piglutExportFrames() and the reader for them, which
+   is built as its own library (libpiglutframes) and needs neither piglut
+   nor GL.
+
+   The exporting process owns a memfd holding this header followed by
+   bufferCount pixel buffers.  Frame n goes into buffer n % bufferCount, so
+   readers get bufferCount - 1 frames of grace before the one they are
+   looking at is reused.  Each buffer has a sequence count (seqlock style)
+   which the writer makes odd while filling it, so readers use the pixels in
+   place and then check, with piglutFrameReaderValid(), that they weren't
+   overwritten meanwhile.  The writer never waits for readers */
+
+#define PIGLUT_FRAMES_MAGIC 0x72666770U /* "pgfr" */
+#define PIGLUT_FRAMES_VERSION 1
+#define PIGLUT_FRAMES_MAX_BUFFERS 8
+
+/* pixel formats, following the output's bpp.  Rows run bottom to top as
+   glReadPixels() returns them */
+#define PIGLUT_FRAMES_RGB565   1 /* 16 bpp, native endian shorts */
+#define PIGLUT_FRAMES_RGB888   2 /* 24 bpp, bytes R, G, B */
+#define PIGLUT_FRAMES_RGBA8888 3 /* 32 bpp, bytes R, G, B, A */
+
+typedef struct
+{
+   /* 2n + 1 while frame n is being written, 2n + 2 once it's complete */
+   unsigned int sequence;
+   unsigned int pad;
+   /* CLOCK_MONOTONIC nanoseconds when the frame was captured */
+   unsigned long long timestamp;
+} piglutFrameSlot_t;
+
+typedef struct
+{
+   unsigned int magic;
+   unsigned int version;
+   unsigned int width;
+   unsigned int height;
+   /* bytes per row */
+   unsigned int stride;
+   unsigned int format;
+   unsigned int bufferCount;
+   /* buffer i starts at headerSize + i * bufferSize, both page multiples */
+   unsigned int headerSize;
+   unsigned int bufferSize;
+   /* frames completed so far, the futex readers wait on */
+   unsigned int frames;
+   /* readers blocked in piglutFrameReaderWait(), the writer only wakes the
+      futex when there are some */
+   unsigned int waiters;
+   unsigned int pad;
+   piglutFrameSlot_t slots[PIGLUT_FRAMES_MAX_BUFFERS];
+} piglutFrameHeader_t;
+
+typedef struct
+{
+   /* points into the shared mapping, valid until the reader is closed */
+   const void * pixels;
+   unsigned int width;
+   unsigned int height;
+   unsigned int stride;
+   unsigned int format;
+   /* counts from 0 */
+   unsigned int number;
+   unsigned long long timestamp;
+} piglutFrame_t;
+
+typedef struct piglutFrameReader piglutFrameReader_t;
+
+/* maps the memfd read only, fd can be closed afterwards.  NULL with errno
+   set on failure, EPROTO if it isn't a piglut frame export */
+piglutFrameReader_t * piglutFrameReaderOpen(int fd);
+
+/* the same, for a descriptor of another process (by /proc/pid/fd) */
+piglutFrameReader_t * piglutFrameReaderOpenProcess(pid_t pid, int fd);
+
+void piglutFrameReaderClose(piglutFrameReader_t * r);
+
+/* the most recently completed frame, -1 with errno EAGAIN if there hasn't
+   been one yet */
+int piglutFrameReaderLatest(piglutFrameReader_t * r, piglutFrame_t * frame);
+
+/* blocks until a frame newer than number after is complete (pass ~0U for
+   any), or timeoutMs passes (ETIMEDOUT).  A negative timeout waits for ever */
+int piglutFrameReaderWait(piglutFrameReader_t * r, unsigned int after,
+                          int timeoutMs, piglutFrame_t * frame);
+
+/* true if the frame's pixels haven't been reused since it was returned.
+   Check after using them and discard the result if not */
+bool piglutFrameReaderValid(piglutFrameReader_t * r, const piglutFrame_t * frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PIGLUTFRAMES_H_ */
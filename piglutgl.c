@@ -0,0 +1,662 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "piglut_internal.h"
+#include "piglutgl.h"
+
+static int capBit(GLenum cap)
+{
+   switch (cap)
+   {
+   case GL_BLEND:                    return 0;
+   case GL_CULL_FACE:                return 1;
+   case GL_DEPTH_TEST:               return 2;
+   case GL_DITHER:                   return 3;
+   case GL_POLYGON_OFFSET_FILL:      return 4;
+   case GL_SAMPLE_ALPHA_TO_COVERAGE: return 5;
+   case GL_SAMPLE_COVERAGE:          return 6;
+   case GL_SCISSOR_TEST:             return 7;
+   case GL_STENCIL_TEST:             return 8;
+   default:                          return -1;
+   }
+}
+
+static int textureTarget(GLenum target)
+{
+   if (target == GL_TEXTURE_2D)
+      return 0;
+   else if (target == GL_TEXTURE_CUBE_MAP)
+      return 1;
+   else
+      return -1;
+}
+
+/* the cache for the current context, NULL if piglut hasn't made one current */
+static glState_t * state(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+   return p ? p->glState : NULL;
+}
+
+static void issued(void *pg)
+{
+   ((piglut_t *)pg)->stats.glCallsIssued++;
+}
+
+static void skipped(void *pg)
+{
+   ((piglut_t *)pg)->stats.glCallsSkipped++;
+}
+
+void piglutGLStateReset(glState_t * s)
+{
+   memset(s, 0xFF, sizeof(glState_t));
+   s->capsKnown = 0;
+   s->attribsKnown = 0;
+   s->viewportKnown = false;
+   s->scissorKnown = false;
+   s->clearColorKnown = false;
+}
+
+void piglutGLStateEnable(piglut_t * p, GLenum cap, bool enable)
+{
+   glState_t * s = p->glState;
+   int bit = capBit(cap);
+
+   if (s && (bit >= 0) && (s->capsKnown & (1U << bit)) &&
+       (((s->capsEnabled >> bit) & 1U) == (enable ? 1U : 0U)))
+   {
+      skipped(p);
+      return;
+   }
+
+   if (enable)
+      glEnable(cap);
+   else
+      glDisable(cap);
+
+   if (s)
+   {
+      issued(p);
+      if (bit >= 0)
+      {
+         s->capsKnown |= 1U << bit;
+         if (enable)
+            s->capsEnabled |= 1U << bit;
+         else
+            s->capsEnabled &= ~(1U << bit);
+      }
+   }
+}
+
+void piglutGLStateScissor(piglut_t * p, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+   glState_t * s = p->glState;
+
+   if (s && s->scissorKnown && (s->scissor[0] == x) && (s->scissor[1] == y) &&
+       (s->scissor[2] == width) && (s->scissor[3] == height))
+   {
+      skipped(p);
+      return;
+   }
+
+   glScissor(x, y, width, height);
+
+   if (s)
+   {
+      issued(p);
+      s->scissorKnown = true;
+      s->scissor[0] = x;
+      s->scissor[1] = y;
+      s->scissor[2] = width;
+      s->scissor[3] = height;
+   }
+}
+
+/* for state piglut sets around callbacks that may have used raw GL calls,
+   so its own settings can't be wrongly skipped */
+void piglutGLStateForgetScissor(glState_t * s)
+{
+   if (s)
+   {
+      s->scissorKnown = false;
+      s->capsKnown &= ~(1U << capBit(GL_SCISSOR_TEST));
+   }
+}
+
+/* true if location already holds value in the program in use, otherwise
+   remembers it so the caller can go ahead and set it */
+static bool uniformUnchanged(void *pg, GLint location, GLenum type,
+                             const void *value, size_t size)
+{
+   piglut_t * p = (piglut_t *)pg;
+   glState_t * s = state(pg);
+   uniformCacheEntry_t * e;
+
+   if (!s || (location < 0) || (s->program == 0) || (s->program == GL_STATE_UNKNOWN))
+      return false;
+
+   if (!p->uniformCache)
+   {
+      p->uniformCache = (uniformCacheEntry_t *)calloc(UNIFORM_CACHE_SIZE, sizeof(uniformCacheEntry_t));
+      if (!p->uniformCache)
+         return false;
+   }
+
+   /* direct mapped, a collision just costs a call */
+   e = &p->uniformCache[((s->program * 2654435761U) ^ (unsigned int)location) & (UNIFORM_CACHE_SIZE - 1)];
+   if ((e->program == s->program) && (e->location == location) && (e->type == type) &&
+       (memcmp(e->value, value, size) == 0))
+      return true;
+
+   e->program = s->program;
+   e->location = location;
+   e->type = type;
+   memcpy(e->value, value, size);
+   return false;
+}
+
+/* after an array upload, which isn't cached, so a later single value set
+   isn't wrongly skipped.  Elements normally take consecutive locations */
+static void forgetUniformArray(void *pg, GLint location, GLsizei count)
+{
+   piglut_t * p = (piglut_t *)pg;
+   glState_t * s = state(pg);
+   GLsizei i;
+
+   if (!s || !p->uniformCache || (location < 0) ||
+       (s->program == 0) || (s->program == GL_STATE_UNKNOWN))
+      return;
+
+   for (i = 0; i < count; i++)
+   {
+      uniformCacheEntry_t * e = &p->uniformCache[((s->program * 2654435761U) ^
+                                                  (unsigned int)(location + i)) & (UNIFORM_CACHE_SIZE - 1)];
+      if ((e->program == s->program) && (e->location == location + i))
+         e->program = 0;
+   }
+}
+
+static void forgetUniforms(void *pg, GLuint program)
+{
+   piglut_t * p = (piglut_t *)pg;
+   unsigned int i;
+
+   if (p && p->uniformCache)
+   {
+      for (i = 0; i < UNIFORM_CACHE_SIZE; i++)
+      {
+         if (p->uniformCache[i].program == program)
+            p->uniformCache[i].program = 0;
+      }
+   }
+}
+
+void piglutInvalidateGLState(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+
+   if (p && p->glState)
+      piglutGLStateReset(p->glState);
+   if (p && p->uniformCache)
+      memset(p->uniformCache, 0, UNIFORM_CACHE_SIZE * sizeof(uniformCacheEntry_t));
+}
+
+void piglutUseProgram(void *pg, GLuint program)
+{
+   glState_t * s = state(pg);
+
+   if (s && (s->program == program))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glUseProgram(program);
+
+   if (s)
+   {
+      issued(pg);
+      s->program = program;
+   }
+}
+
+void piglutLinkProgram(void *pg, GLuint program)
+{
+   /* linking resets every uniform */
+   forgetUniforms(pg, program);
+   glLinkProgram(program);
+}
+
+void piglutDeleteProgram(void *pg, GLuint program)
+{
+   piglut_t * p = (piglut_t *)pg;
+   unsigned int i;
+
+   forgetUniforms(pg, program);
+   glDeleteProgram(program);
+
+   /* the name can be reused, so no context can trust it's still in use */
+   for (i = 0; p && (i < p->outputCount); i++)
+   {
+      if (p->outputs[i].glState.program == program)
+         p->outputs[i].glState.program = GL_STATE_UNKNOWN;
+   }
+}
+
+void piglutActiveTexture(void *pg, GLenum texture)
+{
+   glState_t * s = state(pg);
+
+   if (s && (s->activeTexture == texture))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glActiveTexture(texture);
+
+   if (s)
+   {
+      issued(pg);
+      s->activeTexture = texture;
+   }
+}
+
+void piglutBindTexture(void *pg, GLenum target, GLuint texture)
+{
+   glState_t * s = state(pg);
+   int t = textureTarget(target);
+   GLuint * bound = NULL;
+
+   if (s && (t >= 0) && (s->activeTexture != GL_STATE_UNKNOWN) &&
+       (s->activeTexture - GL_TEXTURE0 < GL_STATE_TEXTURE_UNITS))
+      bound = &s->textures[s->activeTexture - GL_TEXTURE0][t];
+
+   if (bound && (*bound == texture))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glBindTexture(target, texture);
+
+   if (s)
+   {
+      issued(pg);
+      if (bound)
+         *bound = texture;
+   }
+}
+
+void piglutDeleteTextures(void *pg, GLsizei n, const GLuint *textures)
+{
+   piglut_t * p = (piglut_t *)pg;
+   unsigned int i, u, t;
+   GLsizei k;
+
+   glDeleteTextures(n, textures);
+
+   /* only the current context unbinds them, and names get reused */
+   for (i = 0; p && (i < p->outputCount); i++)
+   {
+      glState_t * s = &p->outputs[i].glState;
+      for (u = 0; u < GL_STATE_TEXTURE_UNITS; u++)
+      {
+         for (t = 0; t < 2; t++)
+         {
+            for (k = 0; k < n; k++)
+            {
+               if (s->textures[u][t] == textures[k])
+                  s->textures[u][t] = GL_STATE_UNKNOWN;
+            }
+         }
+      }
+   }
+}
+
+void piglutBindBuffer(void *pg, GLenum target, GLuint buffer)
+{
+   glState_t * s = state(pg);
+   GLuint * bound = NULL;
+
+   if (s && (target == GL_ARRAY_BUFFER))
+      bound = &s->arrayBuffer;
+   else if (s && (target == GL_ELEMENT_ARRAY_BUFFER))
+      bound = &s->elementArrayBuffer;
+
+   if (bound && (*bound == buffer))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glBindBuffer(target, buffer);
+
+   if (s)
+   {
+      issued(pg);
+      if (bound)
+         *bound = buffer;
+   }
+}
+
+void piglutDeleteBuffers(void *pg, GLsizei n, const GLuint *buffers)
+{
+   piglut_t * p = (piglut_t *)pg;
+   unsigned int i;
+   GLsizei k;
+
+   glDeleteBuffers(n, buffers);
+
+   for (i = 0; p && (i < p->outputCount); i++)
+   {
+      glState_t * s = &p->outputs[i].glState;
+      for (k = 0; k < n; k++)
+      {
+         if (s->arrayBuffer == buffers[k])
+            s->arrayBuffer = GL_STATE_UNKNOWN;
+         if (s->elementArrayBuffer == buffers[k])
+            s->elementArrayBuffer = GL_STATE_UNKNOWN;
+      }
+   }
+}
+
+void piglutEnable(void *pg, GLenum cap)
+{
+   if (pg)
+      piglutGLStateEnable((piglut_t *)pg, cap, true);
+   else
+      glEnable(cap);
+}
+
+void piglutDisable(void *pg, GLenum cap)
+{
+   if (pg)
+      piglutGLStateEnable((piglut_t *)pg, cap, false);
+   else
+      glDisable(cap);
+}
+
+static void setVertexAttribArray(void *pg, GLuint index, bool enable)
+{
+   glState_t * s = state(pg);
+   bool tracked = s && (index < GL_STATE_ATTRIBS);
+
+   if (tracked && (s->attribsKnown & (1U << index)) &&
+       (((s->attribsEnabled >> index) & 1U) == (enable ? 1U : 0U)))
+   {
+      skipped(pg);
+      return;
+   }
+
+   if (enable)
+      glEnableVertexAttribArray(index);
+   else
+      glDisableVertexAttribArray(index);
+
+   if (s)
+   {
+      issued(pg);
+      if (tracked)
+      {
+         s->attribsKnown |= 1U << index;
+         if (enable)
+            s->attribsEnabled |= 1U << index;
+         else
+            s->attribsEnabled &= ~(1U << index);
+      }
+   }
+}
+
+void piglutEnableVertexAttribArray(void *pg, GLuint index)
+{
+   setVertexAttribArray(pg, index, true);
+}
+
+void piglutDisableVertexAttribArray(void *pg, GLuint index)
+{
+   setVertexAttribArray(pg, index, false);
+}
+
+void piglutBlendFunc(void *pg, GLenum sfactor, GLenum dfactor)
+{
+   piglutBlendFuncSeparate(pg, sfactor, dfactor, sfactor, dfactor);
+}
+
+void piglutBlendFuncSeparate(void *pg, GLenum srcRGB, GLenum dstRGB,
+                             GLenum srcAlpha, GLenum dstAlpha)
+{
+   glState_t * s = state(pg);
+
+   if (s && (s->blend[0] == srcRGB) && (s->blend[1] == dstRGB) &&
+       (s->blend[2] == srcAlpha) && (s->blend[3] == dstAlpha))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+
+   if (s)
+   {
+      issued(pg);
+      s->blend[0] = srcRGB;
+      s->blend[1] = dstRGB;
+      s->blend[2] = srcAlpha;
+      s->blend[3] = dstAlpha;
+   }
+}
+
+void piglutDepthFunc(void *pg, GLenum func)
+{
+   glState_t * s = state(pg);
+
+   if (s && (s->depthFunc == func))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glDepthFunc(func);
+
+   if (s)
+   {
+      issued(pg);
+      s->depthFunc = func;
+   }
+}
+
+void piglutDepthMask(void *pg, GLboolean flag)
+{
+   glState_t * s = state(pg);
+   unsigned int mask = flag ? 1U : 0U;
+
+   if (s && (s->depthMask == mask))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glDepthMask(flag);
+
+   if (s)
+   {
+      issued(pg);
+      s->depthMask = mask;
+   }
+}
+
+void piglutCullFace(void *pg, GLenum mode)
+{
+   glState_t * s = state(pg);
+
+   if (s && (s->cullFace == mode))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glCullFace(mode);
+
+   if (s)
+   {
+      issued(pg);
+      s->cullFace = mode;
+   }
+}
+
+void piglutViewport(void *pg, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+   glState_t * s = state(pg);
+
+   if (s && s->viewportKnown && (s->viewport[0] == x) && (s->viewport[1] == y) &&
+       (s->viewport[2] == width) && (s->viewport[3] == height))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glViewport(x, y, width, height);
+
+   if (s)
+   {
+      issued(pg);
+      s->viewportKnown = true;
+      s->viewport[0] = x;
+      s->viewport[1] = y;
+      s->viewport[2] = width;
+      s->viewport[3] = height;
+   }
+}
+
+void piglutScissor(void *pg, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+   if (pg)
+      piglutGLStateScissor((piglut_t *)pg, x, y, width, height);
+   else
+      glScissor(x, y, width, height);
+}
+
+void piglutClearColor(void *pg, GLclampf red, GLclampf green,
+                      GLclampf blue, GLclampf alpha)
+{
+   glState_t * s = state(pg);
+
+   if (s && s->clearColorKnown && (s->clearColor[0] == red) && (s->clearColor[1] == green) &&
+       (s->clearColor[2] == blue) && (s->clearColor[3] == alpha))
+   {
+      skipped(pg);
+      return;
+   }
+
+   glClearColor(red, green, blue, alpha);
+
+   if (s)
+   {
+      issued(pg);
+      s->clearColorKnown = true;
+      s->clearColor[0] = red;
+      s->clearColor[1] = green;
+      s->clearColor[2] = blue;
+      s->clearColor[3] = alpha;
+   }
+}
+
+/* the uniform setters all follow the same pattern */
+#define CACHED_UNIFORM(pg, location, type, value, size, call) \
+   do \
+   { \
+      if (uniformUnchanged(pg, location, type, value, size)) \
+         skipped(pg); \
+      else \
+      { \
+         call; \
+         if (state(pg)) \
+            issued(pg); \
+      } \
+   } while (0)
+
+/* arrays go straight through, dropping what the cache knew about them */
+#define UNCACHED_UNIFORM(pg, location, count, call) \
+   do \
+   { \
+      call; \
+      if (state(pg)) \
+      { \
+         forgetUniformArray(pg, location, count); \
+         issued(pg); \
+      } \
+   } while (0)
+
+void piglutUniform1i(void *pg, GLint location, GLint x)
+{
+   CACHED_UNIFORM(pg, location, GL_INT, &x, sizeof(x), glUniform1i(location, x));
+}
+
+void piglutUniform1f(void *pg, GLint location, GLfloat x)
+{
+   CACHED_UNIFORM(pg, location, GL_FLOAT, &x, sizeof(x), glUniform1f(location, x));
+}
+
+void piglutUniform2f(void *pg, GLint location, GLfloat x, GLfloat y)
+{
+   GLfloat v[2] = { x, y };
+   CACHED_UNIFORM(pg, location, GL_FLOAT_VEC2, v, sizeof(v), glUniform2fv(location, 1, v));
+}
+
+void piglutUniform3f(void *pg, GLint location, GLfloat x, GLfloat y, GLfloat z)
+{
+   GLfloat v[3] = { x, y, z };
+   CACHED_UNIFORM(pg, location, GL_FLOAT_VEC3, v, sizeof(v), glUniform3fv(location, 1, v));
+}
+
+void piglutUniform4f(void *pg, GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+   GLfloat v[4] = { x, y, z, w };
+   CACHED_UNIFORM(pg, location, GL_FLOAT_VEC4, v, sizeof(v), glUniform4fv(location, 1, v));
+}
+
+void piglutUniform2fv(void *pg, GLint location, GLsizei count, const GLfloat *v)
+{
+   if (count != 1)
+      UNCACHED_UNIFORM(pg, location, count, glUniform2fv(location, count, v));
+   else
+      CACHED_UNIFORM(pg, location, GL_FLOAT_VEC2, v, 2 * sizeof(GLfloat), glUniform2fv(location, 1, v));
+}
+
+void piglutUniform3fv(void *pg, GLint location, GLsizei count, const GLfloat *v)
+{
+   if (count != 1)
+      UNCACHED_UNIFORM(pg, location, count, glUniform3fv(location, count, v));
+   else
+      CACHED_UNIFORM(pg, location, GL_FLOAT_VEC3, v, 3 * sizeof(GLfloat), glUniform3fv(location, 1, v));
+}
+
+void piglutUniform4fv(void *pg, GLint location, GLsizei count, const GLfloat *v)
+{
+   if (count != 1)
+      UNCACHED_UNIFORM(pg, location, count, glUniform4fv(location, count, v));
+   else
+      CACHED_UNIFORM(pg, location, GL_FLOAT_VEC4, v, 4 * sizeof(GLfloat), glUniform4fv(location, 1, v));
+}
+
+void piglutUniformMatrix3fv(void *pg, GLint location, GLsizei count,
+                            GLboolean transpose, const GLfloat *value)
+{
+   if (count != 1)
+      UNCACHED_UNIFORM(pg, location, count, glUniformMatrix3fv(location, count, transpose, value));
+   else
+      CACHED_UNIFORM(pg, location, GL_FLOAT_MAT3, value, 9 * sizeof(GLfloat),
+                     glUniformMatrix3fv(location, 1, transpose, value));
+}
+
+void piglutUniformMatrix4fv(void *pg, GLint location, GLsizei count,
+                            GLboolean transpose, const GLfloat *value)
+{
+   if (count != 1)
+      UNCACHED_UNIFORM(pg, location, count, glUniformMatrix4fv(location, count, transpose, value));
+   else
+      CACHED_UNIFORM(pg, location, GL_FLOAT_MAT4, value, 16 * sizeof(GLfloat),
+                     glUniformMatrix4fv(location, 1, transpose, value));
+}
@@ -0,0 +1,68 @@
+#ifndef _PIGLUTGL_H_
+#define _PIGLUTGL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <GLES2/gl2.h>
+
+/* Drop-in replacements for the common GL state setters.  piglut remembers
+   what each of its contexts was last set to and drops calls that wouldn't
+   change anything, which saves a trip through the driver.  Counts of calls
+   issued and skipped are in piglutGetStats().
+
+   The cache only knows about state set through these functions.  After
+   changing any of it with GL directly (or through another library), call
+   piglutInvalidateGLState().  Uniform values are cached per program, so
+   programs must be (re)linked and deleted through the wrappers below */
+
+void piglutInvalidateGLState(void *pg);
+
+void piglutUseProgram(void *pg, GLuint program);
+void piglutLinkProgram(void *pg, GLuint program);
+void piglutDeleteProgram(void *pg, GLuint program);
+
+void piglutActiveTexture(void *pg, GLenum texture);
+void piglutBindTexture(void *pg, GLenum target, GLuint texture);
+void piglutDeleteTextures(void *pg, GLsizei n, const GLuint *textures);
+
+void piglutBindBuffer(void *pg, GLenum target, GLuint buffer);
+void piglutDeleteBuffers(void *pg, GLsizei n, const GLuint *buffers);
+
+void piglutEnable(void *pg, GLenum cap);
+void piglutDisable(void *pg, GLenum cap);
+void piglutEnableVertexAttribArray(void *pg, GLuint index);
+void piglutDisableVertexAttribArray(void *pg, GLuint index);
+
+void piglutBlendFunc(void *pg, GLenum sfactor, GLenum dfactor);
+void piglutBlendFuncSeparate(void *pg, GLenum srcRGB, GLenum dstRGB,
+                             GLenum srcAlpha, GLenum dstAlpha);
+void piglutDepthFunc(void *pg, GLenum func);
+void piglutDepthMask(void *pg, GLboolean flag);
+void piglutCullFace(void *pg, GLenum mode);
+void piglutViewport(void *pg, GLint x, GLint y, GLsizei width, GLsizei height);
+void piglutScissor(void *pg, GLint x, GLint y, GLsizei width, GLsizei height);
+void piglutClearColor(void *pg, GLclampf red, GLclampf green,
+                      GLclampf blue, GLclampf alpha);
+
+/* apply to the program in use, only single values (count of 1) are cached.
+   Arrays always reach GL and drop whatever was cached for their elements */
+void piglutUniform1i(void *pg, GLint location, GLint x);
+void piglutUniform1f(void *pg, GLint location, GLfloat x);
+void piglutUniform2f(void *pg, GLint location, GLfloat x, GLfloat y);
+void piglutUniform3f(void *pg, GLint location, GLfloat x, GLfloat y, GLfloat z);
+void piglutUniform4f(void *pg, GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+void piglutUniform2fv(void *pg, GLint location, GLsizei count, const GLfloat *v);
+void piglutUniform3fv(void *pg, GLint location, GLsizei count, const GLfloat *v);
+void piglutUniform4fv(void *pg, GLint location, GLsizei count, const GLfloat *v);
+void piglutUniformMatrix3fv(void *pg, GLint location, GLsizei count,
+                            GLboolean transpose, const GLfloat *value);
+void piglutUniformMatrix4fv(void *pg, GLint location, GLsizei count,
+                            GLboolean transpose, const GLfloat *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PIGLUTGL_H_ */
@@ -0,0 +1,423 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "piglut_internal.h"
+#include "piglutgl.h"
+#include "piglutres.h"
+
+#define INITIAL_RESOURCES 64
+
+/* the driver's own layout isn't visible, so this is an estimate.  RGB is
+   counted as four bytes as most GPUs (VideoCore included) pad it */
+static size_t bytesPerPixel(GLenum format, GLenum type)
+{
+   switch (type)
+   {
+   case GL_UNSIGNED_SHORT_5_6_5:
+   case GL_UNSIGNED_SHORT_4_4_4_4:
+   case GL_UNSIGNED_SHORT_5_5_5_1:
+      return 2;
+   case GL_UNSIGNED_BYTE:
+      switch (format)
+      {
+      case GL_ALPHA:
+      case GL_LUMINANCE:       return 1;
+      case GL_LUMINANCE_ALPHA: return 2;
+      default:                 return 4;
+      }
+   default:
+      return 4;
+   }
+}
+
+static resource_t * lookup(piglut_t * p, int resource)
+{
+   if (!p || (resource < 0) || ((unsigned int)resource >= p->resourceCapacity) ||
+       (p->resources[resource].target == 0))
+      return NULL;
+   return &p->resources[resource];
+}
+
+static void lruUnlink(piglut_t * p, int index)
+{
+   resource_t * r = &p->resources[index];
+
+   if (r->prev >= 0)
+      p->resources[r->prev].next = r->next;
+   else
+      p->lruHead = r->next;
+   if (r->next >= 0)
+      p->resources[r->next].prev = r->prev;
+   else
+      p->lruTail = r->prev;
+   r->prev = -1;
+   r->next = -1;
+}
+
+static void lruPushFront(piglut_t * p, int index)
+{
+   resource_t * r = &p->resources[index];
+
+   r->prev = -1;
+   r->next = p->lruHead;
+   if (p->lruHead >= 0)
+      p->resources[p->lruHead].prev = index;
+   else
+      p->lruTail = index;
+   p->lruHead = index;
+}
+
+static void deleteObject(piglut_t * p, resource_t * r)
+{
+   if (r->target == GL_TEXTURE_2D)
+      piglutDeleteTextures(p, 1, &r->name);
+   else
+      piglutDeleteBuffers(p, 1, &r->name);
+   r->name = 0;
+
+   p->stats.gpuBytesResident -= r->size;
+   p->stats.resourcesResident--;
+}
+
+static void evict(piglut_t * p, int index)
+{
+   lruUnlink(p, index);
+   deleteObject(p, &p->resources[index]);
+   p->stats.resourceEvictions++;
+}
+
+/* frees the least recently used reloadable resources until size more bytes
+   fit in the budget.  False if that isn't possible without touching ones
+   used this frame */
+static bool makeRoom(piglut_t * p, size_t size)
+{
+   int index = p->lruTail;
+
+   if (p->gpuBudget == 0)
+      return true;
+
+   while (p->stats.gpuBytesResident + size > p->gpuBudget)
+   {
+      int prev;
+
+      /* skip over anything pinned or in use */
+      while ((index >= 0) && (!p->resources[index].reload ||
+                              (p->resources[index].lastUsed == p->frameNumber)))
+         index = p->resources[index].prev;
+
+      if (index < 0)
+         return false;
+
+      prev = p->resources[index].prev;
+      evict(p, index);
+      index = prev;
+   }
+   return true;
+}
+
+static int allocResource(piglut_t * p)
+{
+   int index;
+
+   if (p->resourceFree < 0)
+   {
+      unsigned int capacity = p->resourceCapacity ? p->resourceCapacity * 2 : INITIAL_RESOURCES;
+      resource_t * resources = (resource_t *)realloc(p->resources, capacity * sizeof(resource_t));
+      unsigned int i;
+
+      if (!resources)
+      {
+         errno = ENOMEM;
+         return -1;
+      }
+
+      /* the new slots go on the free list, lowest first */
+      for (i = capacity; i-- > p->resourceCapacity; )
+      {
+         resources[i].target = 0;
+         resources[i].next = p->resourceFree;
+         p->resourceFree = (int)i;
+      }
+      p->resources = resources;
+      p->resourceCapacity = capacity;
+   }
+
+   index = p->resourceFree;
+   p->resourceFree = p->resources[index].next;
+   return index;
+}
+
+static void freeResource(piglut_t * p, int index)
+{
+   p->resources[index].target = 0;
+   p->resources[index].next = p->resourceFree;
+   p->resourceFree = index;
+}
+
+/* creates and binds the GL object, then uploads data or hands over to the
+   reload callback */
+static int upload(piglut_t * p, int index, const void *data, bool reload)
+{
+   resource_t * r = &p->resources[index];
+
+   if (r->target == GL_TEXTURE_2D)
+   {
+      glGenTextures(1, &r->name);
+      piglutBindTexture(p, GL_TEXTURE_2D, r->name);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      if (!reload)
+         glTexImage2D(GL_TEXTURE_2D, 0, r->format, r->width, r->height, 0,
+                      r->format, r->type, data);
+   }
+   else
+   {
+      glGenBuffers(1, &r->name);
+      piglutBindBuffer(p, r->target, r->name);
+      if (!reload)
+         glBufferData(r->target, (GLsizeiptr)r->size, data, r->format);
+   }
+
+   p->stats.gpuBytesResident += r->size;
+   p->stats.resourcesResident++;
+   if (p->stats.gpuBytesResident > p->stats.gpuBytesPeak)
+      p->stats.gpuBytesPeak = p->stats.gpuBytesResident;
+
+   if (reload && (r->reload(p, index, r->userData) != 0))
+   {
+      deleteObject(p, r);
+      errno = EIO;
+      return -1;
+   }
+
+   /* only a use protects it for the frame, creating doesn't, so loading
+      more than fits (say at start up) pushes out the oldest instead */
+   r->lastUsed = reload ? p->frameNumber : p->frameNumber - 1;
+   lruPushFront(p, index);
+   return 0;
+}
+
+static int create(piglut_t * p, const resource_t * desc, const void *data)
+{
+   int index;
+
+   if (!p || !p->glState)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   if (!makeRoom(p, desc->size))
+   {
+      errno = ENOSPC;
+      return -1;
+   }
+
+   index = allocResource(p);
+   if (index < 0)
+      return -1;
+
+   p->resources[index] = *desc;
+   upload(p, index, data, false);
+   p->stats.resourcesLive++;
+   return index;
+}
+
+int piglutSetGPUBudget(void *pg, size_t bytes)
+{
+   piglut_t * p = (piglut_t *)pg;
+   if (p)
+   {
+      p->gpuBudget = bytes;
+      /* as far as it can, the rest goes as soon as it's unused */
+      makeRoom(p, 0);
+      return 0;
+   }
+   else
+   {
+      errno = EINVAL;
+      return -1;
+   }
+}
+
+int piglutCreateTexture(void *pg, GLsizei width, GLsizei height,
+                        GLenum format, GLenum type, const void *pixels,
+                        piglutReloadCallback reload, void *userData)
+{
+   resource_t desc;
+
+   if ((width <= 0) || (height <= 0))
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   memset(&desc, 0, sizeof(desc));
+   desc.target = GL_TEXTURE_2D;
+   desc.width = width;
+   desc.height = height;
+   desc.format = format;
+   desc.type = type;
+   desc.size = (size_t)width * (size_t)height * bytesPerPixel(format, type);
+   desc.reload = reload;
+   desc.userData = userData;
+   return create((piglut_t *)pg, &desc, pixels);
+}
+
+int piglutCreateBuffer(void *pg, GLenum target, GLsizeiptr size,
+                       const void *data, GLenum usage,
+                       piglutReloadCallback reload, void *userData)
+{
+   resource_t desc;
+
+   if (((target != GL_ARRAY_BUFFER) && (target != GL_ELEMENT_ARRAY_BUFFER)) ||
+       (size <= 0))
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   memset(&desc, 0, sizeof(desc));
+   desc.target = target;
+   /* buffers keep their usage hint in format */
+   desc.format = usage;
+   desc.size = (size_t)size;
+   desc.reload = reload;
+   desc.userData = userData;
+   return create((piglut_t *)pg, &desc, data);
+}
+
+GLuint piglutUseResource(void *pg, int resource)
+{
+   piglut_t * p = (piglut_t *)pg;
+   resource_t * r = lookup(p, resource);
+
+   if (!r)
+   {
+      errno = EINVAL;
+      return 0;
+   }
+
+   if (r->name == 0)
+   {
+      if (!makeRoom(p, r->size))
+      {
+         errno = ENOSPC;
+         return 0;
+      }
+      if (upload(p, resource, NULL, true) != 0)
+         return 0;
+      r->used = true;
+      p->stats.resourceReloads++;
+      return r->name;
+   }
+
+   r->lastUsed = p->frameNumber;
+   r->used = true;
+   if (p->lruHead != resource)
+   {
+      lruUnlink(p, resource);
+      lruPushFront(p, resource);
+   }
+   return r->name;
+}
+
+int piglutSetResourceSize(void *pg, int resource, size_t bytes)
+{
+   piglut_t * p = (piglut_t *)pg;
+   resource_t * r = lookup(p, resource);
+
+   if (!r)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   if (r->name != 0)
+   {
+      p->stats.gpuBytesResident = p->stats.gpuBytesResident - r->size + bytes;
+      if (p->stats.gpuBytesResident > p->stats.gpuBytesPeak)
+         p->stats.gpuBytesPeak = p->stats.gpuBytesResident;
+   }
+   r->size = bytes;
+   makeRoom(p, 0);
+   return 0;
+}
+
+int piglutDestroyResource(void *pg, int resource)
+{
+   piglut_t * p = (piglut_t *)pg;
+   resource_t * r = lookup(p, resource);
+
+   if (!r)
+   {
+      errno = EINVAL;
+      return -1;
+   }
+
+   if (r->name != 0)
+   {
+      lruUnlink(p, resource);
+      deleteObject(p, r);
+   }
+   freeResource(p, resource);
+   p->stats.resourcesLive--;
+   return 0;
+}
+
+void piglutDumpResources(void *pg)
+{
+   piglut_t * p = (piglut_t *)pg;
+   unsigned int i;
+
+   if (!p)
+      return;
+
+   fprintf(stderr, "piglut: %u GPU resources, %llu bytes resident (peak %llu",
+           p->stats.resourcesLive, p->stats.gpuBytesResident, p->stats.gpuBytesPeak);
+   if (p->gpuBudget)
+      fprintf(stderr, ", budget %zu", p->gpuBudget);
+   fprintf(stderr, "), %llu evictions, %llu reloads\n",
+           p->stats.resourceEvictions, p->stats.resourceReloads);
+
+   for (i = 0; i < p->resourceCapacity; i++)
+   {
+      resource_t * r = &p->resources[i];
+
+      if (r->target == 0)
+         continue;
+
+      if (r->target == GL_TEXTURE_2D)
+         fprintf(stderr, "  %4u texture %dx%d", i, r->width, r->height);
+      else
+         fprintf(stderr, "  %4u %s buffer", i,
+                 (r->target == GL_ARRAY_BUFFER) ? "vertex" : "index");
+      fprintf(stderr, ", %zu bytes, %s", r->size,
+              r->name ? (r->reload ? "resident" : "pinned") : "evicted");
+      if (r->used)
+         fprintf(stderr, ", last used in frame %u\n", r->lastUsed);
+      else
+         fprintf(stderr, ", never used\n");
+   }
+}
+
+void piglutResourcesTerm(piglut_t * p)
+{
+   unsigned int i;
+
+   if (p->stats.resourcesLive)
+   {
+      piglutDumpResources(p);
+      for (i = 0; i < p->resourceCapacity; i++)
+         if ((p->resources[i].target != 0) && p->glState)
+            piglutDestroyResource(p, (int)i);
+   }
+
+   free(p->resources);
+   p->resources = NULL;
+   p->resourceCapacity = 0;
+}
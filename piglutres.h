@@ -0,0 +1,61 @@
+#ifndef _PIGLUTRES_H_
+#define _PIGLUTRES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <GLES2/gl2.h>
+
+/* Tracked GPU resources.  Textures and buffers created here are recorded
+   with an estimate of their size, and the total is kept under the budget
+   set by piglutSetGPUBudget() by deleting the least recently used ones that
+   have a reload callback.  Those are recreated the next time they are
+   passed to piglutUseResource(), so look the GL name up there each frame
+   rather than keeping it.  Anything used in the current frame stays put,
+   and resources without a reload callback are never evicted.
+
+   Usage is in piglutGetStats(), and piglutTerm() reports anything still
+   alive.  Everything here must be called on the main loop with a context
+   current (from initCb, displayCb or the other callbacks).  Functions return
+   0 (or a handle), or -1 with errno set */
+
+/* called with the recreated object bound, the texture to GL_TEXTURE_2D on
+   the active unit or the buffer to its target, to upload its contents again
+   the same way they were created.  Returns 0 on success */
+typedef int (*piglutReloadCallback)(void *pg, int resource, void *userData);
+
+/* bytes, 0 (the default) for no limit.  Evicts straight away if needed */
+int piglutSetGPUBudget(void *pg, size_t bytes);
+
+/* a 2D texture with linear filtering and clamped edges, so any size is
+   complete.  pixels may be NULL.  Fails with ENOSPC if it won't fit in the
+   budget, returns a resource handle */
+int piglutCreateTexture(void *pg, GLsizei width, GLsizei height,
+                        GLenum format, GLenum type, const void *pixels,
+                        piglutReloadCallback reload, void *userData);
+
+/* target is GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER, data may be NULL */
+int piglutCreateBuffer(void *pg, GLenum target, GLsizeiptr size,
+                       const void *data, GLenum usage,
+                       piglutReloadCallback reload, void *userData);
+
+/* marks the resource used this frame, reloading it first if it was evicted,
+   and returns its GL name.  0 if it couldn't be reloaded */
+GLuint piglutUseResource(void *pg, int resource);
+
+/* replaces the estimate, for uploads piglut doesn't see such as mipmaps or
+   compressed data */
+int piglutSetResourceSize(void *pg, int resource, size_t bytes);
+
+int piglutDestroyResource(void *pg, int resource);
+
+/* lists every live resource on stderr */
+void piglutDumpResources(void *pg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PIGLUTRES_H_ */
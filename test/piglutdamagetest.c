@@ -0,0 +1,64 @@
+#include <GLES2/gl2.h>
+
+#include "test.h"
+#include "piglut.h"
+
+#define SIZE 32
+
+static unsigned int frame;
+static unsigned int calls;
+static GLint box[4];
+
+/* posts rects meaning "everything" the ways an app might, then checks the
+   next frame is drawn as one region covering the whole surface */
+static void wholeSurfaceDisplay(void *pg)
+{
+   static const piglutRect_t everything = { 0, 0, 0xFFFFFFFFU, 0xFFFFFFFFU };
+   static const piglutRect_t offset = { -5, -5, 0xFFFFFFFFU, 0xFFFFFFFFU };
+   static const piglutRect_t corner = { 1, 1, 2, 2 };
+   unsigned int i;
+
+   calls++;
+   glGetIntegerv(GL_SCISSOR_BOX, box);
+
+   switch (frame)
+   {
+   case 0:
+      /* the first frame is a full redraw anyway */
+      piglutPostDamage(pg, &everything);
+      break;
+   case 1:
+      CHECK(calls == 2);
+      CHECK((box[0] == 0) && (box[1] == 0) && (box[2] == SIZE) && (box[3] == SIZE));
+
+      /* overflows the damage list, so gets folded into the last entry */
+      for (i = 0; i < 20; i++)
+         piglutPostDamage(pg, &corner);
+      piglutPostDamage(pg, &offset);
+      break;
+   case 2:
+      CHECK(calls == 3);
+      CHECK((box[0] == 0) && (box[1] == 0) && (box[2] == SIZE) && (box[3] == SIZE));
+      piglutLeaveMainLoop(pg);
+      break;
+   }
+   frame++;
+}
+
+static void wholeSurface(void)
+{
+   void *pg = testCreate(SIZE, SIZE);
+
+   frame = 0;
+   calls = 0;
+   piglutDisplayFunc(pg, wholeSurfaceDisplay);
+   piglutSetPartialUpdate(pg, true);
+   CHECK(piglutMainLoop(pg) == 0);
+   CHECK(frame == 3);
+   piglutTerm(pg);
+}
+
+void piglutDamageTests(void)
+{
+   wholeSurface();
+}
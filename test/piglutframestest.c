@@ -0,0 +1,368 @@
+/* memfd_create() */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+#include "test.h"
+#include "piglut.h"
+#include "piglutframes.h"
+
+#define WIDTH 8
+#define HEIGHT 4
+#define BUFFERS 2
+#define PAGE 4096
+
+/* a stand in for the writer in piglutexport.c, so the reader can be
+   driven through each case without GL */
+typedef struct
+{
+   int fd;
+   piglutFrameHeader_t * header;
+   size_t size;
+} fakeExport_t;
+
+static bool fakeOpen(fakeExport_t * f)
+{
+   piglutFrameHeader_t * h;
+
+   f->size = PAGE * (1 + BUFFERS);
+   f->fd = memfd_create("pigluttest", MFD_CLOEXEC);
+   if ((f->fd < 0) || (ftruncate(f->fd, (off_t)f->size) != 0))
+      return false;
+
+   h = (piglutFrameHeader_t *)mmap(NULL, f->size, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+   if (h == MAP_FAILED)
+      return false;
+
+   h->version = PIGLUT_FRAMES_VERSION;
+   h->width = WIDTH;
+   h->height = HEIGHT;
+   h->stride = WIDTH * 4;
+   h->format = PIGLUT_FRAMES_RGBA8888;
+   h->bufferCount = BUFFERS;
+   h->headerSize = PAGE;
+   h->bufferSize = PAGE;
+   h->magic = PIGLUT_FRAMES_MAGIC;
+   f->header = h;
+   return true;
+}
+
+static void fakeClose(fakeExport_t * f)
+{
+   munmap(f->header, f->size);
+   close(f->fd);
+}
+
+/* starts writing frame n into its buffer */
+static void fakeBegin(fakeExport_t * f, unsigned int n)
+{
+   __atomic_store_n(&f->header->slots[n % BUFFERS].sequence, 2 * n + 1, __ATOMIC_SEQ_CST);
+}
+
+/* finishes frame n and wakes any waiting readers */
+static void fakeEnd(fakeExport_t * f, unsigned int n)
+{
+   __atomic_store_n(&f->header->slots[n % BUFFERS].sequence, 2 * n + 2, __ATOMIC_SEQ_CST);
+   __atomic_store_n(&f->header->frames, n + 1, __ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&f->header->waiters, __ATOMIC_SEQ_CST))
+      syscall(SYS_futex, &f->header->frames, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void fakePublish(fakeExport_t * f, unsigned int n)
+{
+   fakeBegin(f, n);
+   fakeEnd(f, n);
+}
+
+static double now(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + (t.tv_nsec * 1e-9);
+}
+
+static void sleepMs(unsigned int ms)
+{
+   struct timespec t = { 0, (long)ms * 1000000L };
+   nanosleep(&t, NULL);
+}
+
+static void latestAndValid(void)
+{
+   fakeExport_t f;
+   piglutFrameReader_t * r;
+   piglutFrame_t frame;
+
+   if (!CHECK(fakeOpen(&f)))
+      return;
+   r = piglutFrameReaderOpen(f.fd);
+   if (!CHECK(r != NULL))
+   {
+      fakeClose(&f);
+      return;
+   }
+
+   errno = 0;
+   CHECK((piglutFrameReaderLatest(r, &frame) == -1) && (errno == EAGAIN));
+
+   fakePublish(&f, 0);
+   CHECK((piglutFrameReaderLatest(r, &frame) == 0) && (frame.number == 0));
+   CHECK((frame.width == WIDTH) && (frame.height == HEIGHT) && (frame.stride == WIDTH * 4));
+   CHECK(piglutFrameReaderValid(r, &frame));
+
+   /* frame 2 shares its buffer, so starting on it spoils frame 0 */
+   fakePublish(&f, 1);
+   CHECK(piglutFrameReaderValid(r, &frame));
+   fakeBegin(&f, 2);
+   CHECK(!piglutFrameReaderValid(r, &frame));
+
+   piglutFrameReaderClose(r);
+   fakeClose(&f);
+}
+
+static void * lapWriter(void *arg)
+{
+   fakeExport_t * f = (fakeExport_t *)arg;
+
+   sleepMs(20);
+   fakeEnd(f, 3);
+   fakeEnd(f, 4);
+   return NULL;
+}
+
+/* the reader sees the frame count, but the writer has lapped it and is
+   part way into that frame's buffer, so it has to go round again */
+static void latestRetry(void)
+{
+   fakeExport_t f;
+   piglutFrameReader_t * r;
+   piglutFrame_t frame;
+   pthread_t writer;
+
+   if (!CHECK(fakeOpen(&f)))
+      return;
+   r = piglutFrameReaderOpen(f.fd);
+   if (!CHECK(r != NULL))
+   {
+      fakeClose(&f);
+      return;
+   }
+
+   fakePublish(&f, 0);
+   fakePublish(&f, 1);
+   fakePublish(&f, 2);
+   fakeBegin(&f, 3);
+   fakeBegin(&f, 4);
+
+   pthread_create(&writer, NULL, lapWriter, &f);
+   CHECK((piglutFrameReaderLatest(r, &frame) == 0) && (frame.number == 4));
+   CHECK(piglutFrameReaderValid(r, &frame));
+   pthread_join(writer, NULL);
+
+   piglutFrameReaderClose(r);
+   fakeClose(&f);
+}
+
+typedef struct
+{
+   piglutFrameReader_t * reader;
+   unsigned int after;
+   int timeoutMs;
+   int result;
+   int error;
+   piglutFrame_t frame;
+   double seconds;
+} waitCall_t;
+
+static void * waitThread(void *arg)
+{
+   waitCall_t * w = (waitCall_t *)arg;
+   double start = now();
+
+   w->result = piglutFrameReaderWait(w->reader, w->after, w->timeoutMs, &w->frame);
+   w->error = errno;
+   w->seconds = now() - start;
+   return NULL;
+}
+
+/* registers as a waiter and sleeps on the futex until woken */
+static void waitFutex(void)
+{
+   fakeExport_t f;
+   waitCall_t w;
+   pthread_t waiter;
+   int i;
+
+   if (!CHECK(fakeOpen(&f)))
+      return;
+   memset(&w, 0, sizeof(w));
+   w.reader = piglutFrameReaderOpen(f.fd);
+   if (!CHECK(w.reader != NULL))
+   {
+      fakeClose(&f);
+      return;
+   }
+
+   fakePublish(&f, 0);
+   w.after = 0;
+   w.timeoutMs = -1;
+   pthread_create(&waiter, NULL, waitThread, &w);
+
+   for (i = 0; (i < 1000) && !__atomic_load_n(&f.header->waiters, __ATOMIC_SEQ_CST); i++)
+      sleepMs(1);
+   CHECK(f.header->waiters == 1);
+
+   /* with no timeout it can only return by being woken */
+   sleepMs(20);
+   fakePublish(&f, 1);
+   pthread_join(waiter, NULL);
+
+   CHECK((w.result == 0) && (w.frame.number == 1));
+   CHECK(f.header->waiters == 0);
+
+   /* nothing newer comes */
+   w.after = 1;
+   w.timeoutMs = 50;
+   waitThread(&w);
+   CHECK((w.result == -1) && (w.error == ETIMEDOUT));
+   CHECK((w.seconds >= 0.045) && (w.seconds < 1.0));
+
+   piglutFrameReaderClose(w.reader);
+   fakeClose(&f);
+}
+
+/* a reader that can't write the header polls, the writer never wakes it */
+static void waitPolling(void)
+{
+   fakeExport_t f;
+   waitCall_t w;
+   pthread_t waiter;
+   char path[64];
+   int fd;
+
+   if (!CHECK(fakeOpen(&f)))
+      return;
+   snprintf(path, sizeof(path), "/proc/self/fd/%d", f.fd);
+   fd = open(path, O_RDONLY | O_CLOEXEC);
+   memset(&w, 0, sizeof(w));
+   w.reader = piglutFrameReaderOpen(fd);
+   close(fd);
+   if (!CHECK(w.reader != NULL))
+   {
+      fakeClose(&f);
+      return;
+   }
+
+   fakePublish(&f, 0);
+   w.after = 0;
+   w.timeoutMs = 5000;
+   pthread_create(&waiter, NULL, waitThread, &w);
+   sleepMs(20);
+   CHECK(f.header->waiters == 0);
+   fakePublish(&f, 1);
+   pthread_join(waiter, NULL);
+
+   CHECK((w.result == 0) && (w.frame.number == 1));
+   CHECK(w.seconds < 1.0);
+
+   piglutFrameReaderClose(w.reader);
+   fakeClose(&f);
+}
+
+/* the real writer, swapping through piglut on even frames and with plain
+   eglSwapBuffers() on odd ones */
+#define EXPORT_FRAMES 6
+#define EXPORT_SIZE 16
+
+static piglutFrameReader_t * reader;
+static unsigned int frame;
+
+static unsigned char shade(unsigned int n)
+{
+   return (unsigned char)(n * 40);
+}
+
+static void exportDisplay(void *pg)
+{
+   piglutFrame_t f;
+
+   /* the previous frame has gone out, however it was swapped */
+   if (frame > 0)
+   {
+      const unsigned char * pixel;
+
+      if (CHECK((piglutFrameReaderLatest(reader, &f) == 0) && (f.number == frame - 1)))
+      {
+         CHECK((f.width == EXPORT_SIZE) && (f.height == EXPORT_SIZE));
+         CHECK(f.format == PIGLUT_FRAMES_RGBA8888);
+         pixel = (const unsigned char *)f.pixels + (EXPORT_SIZE / 2) * f.stride + (EXPORT_SIZE / 2) * 4;
+         CHECK((pixel[0] == shade(frame - 1)) && (pixel[1] == 0) && (pixel[2] == 255));
+         CHECK(piglutFrameReaderValid(reader, &f));
+      }
+   }
+
+   if (frame == EXPORT_FRAMES)
+   {
+      piglutLeaveMainLoop(pg);
+      return;
+   }
+
+   glClearColor(shade(frame) / 255.0f, 0.0f, 1.0f, 1.0f);
+   glClear(GL_COLOR_BUFFER_BIT);
+   if (frame & 1)
+      eglSwapBuffers(eglGetCurrentDisplay(), eglGetCurrentSurface(EGL_DRAW));
+   else
+      piglutSwapBuffers(pg);
+   frame++;
+}
+
+static void exportInit(void *pg)
+{
+   int fd = piglutExportFrames(pg, 0, 3);
+
+   reader = CHECK(fd >= 0) ? piglutFrameReaderOpen(fd) : NULL;
+   CHECK(reader != NULL);
+}
+
+static void exportFrames(void)
+{
+   void *pg = testCreate(EXPORT_SIZE, EXPORT_SIZE);
+   piglutStats_t stats;
+
+   frame = 0;
+   reader = NULL;
+   piglutInitFunc(pg, exportInit);
+   piglutDisplayFunc(pg, exportDisplay);
+   CHECK(piglutMainLoop(pg) == 0);
+   CHECK(frame == EXPORT_FRAMES);
+
+   piglutGetStats(pg, &stats);
+   /* plus the last call, which only checks, as piglut can't tell that
+      apart from one that swapped itself */
+   CHECK(stats.framesExported == EXPORT_FRAMES + 1);
+
+   piglutFrameReaderClose(reader);
+   piglutTerm(pg);
+}
+
+void piglutFramesTests(void)
+{
+   latestAndValid();
+   latestRetry();
+   waitFutex();
+   waitPolling();
+   exportFrames();
+}
@@ -0,0 +1,114 @@
+#include <stddef.h>
+
+#include <GLES2/gl2.h>
+
+#include "test.h"
+#include "piglut.h"
+#include "piglutgl.h"
+
+#define SIZE 32
+#define FRAMES 4
+
+static unsigned int frame;
+
+/* apps mix raw GL calls with the cached wrappers in displayCb, which must
+   not leave piglut's own scissor for the next region skipped as redundant */
+static void rawScissorDisplay(void *pg)
+{
+   static const piglutRect_t everything = { 0, 0, SIZE, SIZE };
+   GLint box[4];
+
+   glGetIntegerv(GL_SCISSOR_BOX, box);
+   CHECK(glIsEnabled(GL_SCISSOR_TEST));
+   CHECK((box[0] == 0) && (box[1] == 0) && (box[2] == SIZE) && (box[3] == SIZE));
+
+   if (frame & 1)
+   {
+      piglutScissor(pg, 0, 0, 2, 2);
+      glScissor(0, 0, 4, 4);
+   }
+   else
+   {
+      glScissor(0, 0, 2, 2);
+      glDisable(GL_SCISSOR_TEST);
+   }
+
+   piglutPostDamage(pg, &everything);
+   if (++frame == FRAMES)
+      piglutLeaveMainLoop(pg);
+}
+
+static void rawScissor(void)
+{
+   void *pg = testCreate(SIZE, SIZE);
+
+   frame = 0;
+   piglutDisplayFunc(pg, rawScissorDisplay);
+   piglutSetPartialUpdate(pg, true);
+   CHECK(piglutMainLoop(pg) == 0);
+   CHECK(frame == FRAMES);
+   piglutTerm(pg);
+}
+
+static GLuint compile(GLenum type, const char *source)
+{
+   GLuint shader = glCreateShader(type);
+   glShaderSource(shader, 1, &source, NULL);
+   glCompileShader(shader);
+   return shader;
+}
+
+/* an array upload between two identical single value sets */
+static void uniformArraysInit(void *pg)
+{
+   static const GLfloat a[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+   static const GLfloat b[8] = { 9.0f, 9.0f, 9.0f, 9.0f, 8.0f, 8.0f, 8.0f, 8.0f };
+   GLuint program = glCreateProgram();
+   GLint u0, u1;
+   GLfloat value[4];
+   piglutStats_t before, after;
+
+   glAttachShader(program, compile(GL_VERTEX_SHADER,
+                                    "uniform vec4 u[4];\n"
+                                    "attribute vec4 position;\n"
+                                    "void main() { gl_Position = position + u[0] + u[1] + u[2] + u[3]; }\n"));
+   glAttachShader(program, compile(GL_FRAGMENT_SHADER,
+                                   "void main() { gl_FragColor = vec4(1.0); }\n"));
+   glLinkProgram(program);
+   piglutUseProgram(pg, program);
+   u0 = glGetUniformLocation(program, "u[0]");
+   u1 = glGetUniformLocation(program, "u[1]");
+
+   piglutGetStats(pg, &before);
+   piglutUniform4fv(pg, u0, 1, a);
+   piglutUniform4fv(pg, u1, 1, a);
+   piglutUniform4fv(pg, u0, 2, b);
+   piglutUniform4fv(pg, u0, 1, a);
+   piglutUniform4fv(pg, u1, 1, a);
+   piglutGetStats(pg, &after);
+
+   glGetUniformfv(program, u0, value);
+   CHECK(value[0] == 1.0f);
+   glGetUniformfv(program, u1, value);
+   CHECK(value[0] == 1.0f);
+   CHECK(after.glCallsIssued - before.glCallsIssued == 5);
+   CHECK(after.glCallsSkipped == before.glCallsSkipped);
+
+   piglutDeleteProgram(pg, program);
+   piglutLeaveMainLoop(pg);
+}
+
+static void uniformArrays(void)
+{
+   void *pg = testCreate(SIZE, SIZE);
+
+   piglutInitFunc(pg, uniformArraysInit);
+   CHECK(piglutMainLoop(pg) == 0);
+   piglutTerm(pg);
+}
+
+void piglutGLTests(void)
+{
+   rawScissor();
+   uniformArrays();
+}
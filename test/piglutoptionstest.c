@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "test.h"
+#include "piglut.h"
+
+static unsigned int requested;
+
+static void readStats(void *pg)
+{
+   piglutStats_t stats;
+
+   piglutGetStats(pg, &stats);
+   requested = stats.latencyRequested;
+   piglutLeaveMainLoop(pg);
+}
+
+/* the parts of the latency profile asked for by the given argument */
+static unsigned int latencyRequested(const char *arg)
+{
+   char *argv[] = { "pigluttest", (char *)arg, NULL };
+   void *pg = piglutInit(arg ? 2 : 1, argv);
+   piglutWindowConfig_t wc;
+
+   piglutInitWindowConfig(&wc);
+   wc.width = 16;
+   wc.height = 16;
+   piglutInitWindowSize(pg, &wc);
+   piglutDisplayFunc(pg, readStats);
+
+   requested = ~0U;
+   CHECK(piglutMainLoop(pg) == 0);
+   piglutTerm(pg);
+
+   /* don't leave the rest of the tests locked in */
+   munlockall();
+   return requested;
+}
+
+/* an empty value, on the command line or in the environment, isn't a
+   request to turn anything on */
+static void flags(void)
+{
+   unsetenv("PIGLUT_LATENCY");
+   unsetenv("PIGLUT_MLOCK");
+
+   CHECK(latencyRequested(NULL) == 0);
+   CHECK(latencyRequested("--piglut-mlock") == PIGLUT_LATENCY_MLOCK);
+   CHECK(latencyRequested("--piglut-mlock=1") == PIGLUT_LATENCY_MLOCK);
+   CHECK(latencyRequested("--piglut-mlock=0") == 0);
+   CHECK(latencyRequested("--piglut-mlock=") == 0);
+
+   setenv("PIGLUT_MLOCK", "", 1);
+   CHECK(latencyRequested(NULL) == 0);
+   unsetenv("PIGLUT_MLOCK");
+
+   setenv("PIGLUT_LATENCY", "", 1);
+   CHECK(latencyRequested(NULL) == 0);
+   unsetenv("PIGLUT_LATENCY");
+}
+
+void piglutOptionsTests(void)
+{
+   flags();
+}
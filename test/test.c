@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include "piglut.h"
+
+/* longer than any test should take, so a stuck main loop fails rather
+   than hangs */
+#define TIMEOUT_MS 5000
+
+static unsigned int checks;
+static unsigned int failures;
+
+bool testCheck(bool ok, const char *what, const char *file, int line)
+{
+   checks++;
+   if (!ok)
+   {
+      failures++;
+      fprintf(stderr, "%s:%d: failed: %s\n", file, line, what);
+   }
+   return ok;
+}
+
+static void timeout(void *pg, int value)
+{
+   CHECK(!"main loop timed out");
+   piglutLeaveMainLoop(pg);
+}
+
+void * testCreate(unsigned int width, unsigned int height)
+{
+   void *pg = piglutInit(0, NULL);
+   piglutWindowConfig_t wc;
+
+   piglutInitWindowConfig(&wc);
+   wc.width = width;
+   wc.height = height;
+   piglutInitWindowSize(pg, &wc);
+   piglutTimerFunc(pg, TIMEOUT_MS, timeout, 0);
+   return pg;
+}
+
+int main(int argc, char **argv)
+{
+   const char *filter = (argc > 1) ? argv[1] : NULL;
+
+   if (!filter || (strcmp(filter, "damage") == 0))
+      piglutDamageTests();
+   if (!filter || (strcmp(filter, "gl") == 0))
+      piglutGLTests();
+   if (!filter || (strcmp(filter, "options") == 0))
+      piglutOptionsTests();
+   if (!filter || (strcmp(filter, "frames") == 0))
+      piglutFramesTests();
+
+   fprintf(stderr, "%u checks, %u failed\n", checks, failures);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,29 @@
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* records a failure, with where it happened, if cond is false.  Returns
+   cond so a test can give up on anything that depends on it */
+#define CHECK(cond) testCheck((cond), #cond, __FILE__, __LINE__)
+
+bool testCheck(bool ok, const char *what, const char *file, int line);
+
+/* a piglut with output 0 set to the given size, whose main loop gives up
+   after a few seconds */
+void * testCreate(unsigned int width, unsigned int height);
+
+void piglutDamageTests(void);
+void piglutGLTests(void);
+void piglutOptionsTests(void);
+void piglutFramesTests(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TEST_H_ */